@@ -19,6 +19,14 @@ export default class GamaInstance {
     this.window.side = Math.min(width, height);
     this.window.x = (width - this.window.side) / 2;
     this.window.y = (height - this.window.side) / 2;
+    this.postSize(width, height);
+  }
+  postSize(width, height) {
+    if (this.worker)
+      this.worker.postMessage({
+        type: 'event/resize',
+        size: [width, height],
+      });
   }
   maximize() {
     for (const ctx of this.contexts) {
@@ -145,6 +153,7 @@ export default class GamaInstance {
         this.window.x = (d.width - this.window.side) / 2;
         this.window.y = (d.height - this.window.side) / 2;
         this.applySize();
+        this.postSize(d.width, d.height);
         this.ctx = this.canv.getContext('2d');
         try {
           document.querySelector('title').innerHTML = d.title;
@@ -425,6 +434,7 @@ const workerfn = () => {
     state: 'unready',
     queue: [],
     init: { width: 500, height: 500, title: "gama app" },
+    size: { width: 500, height: 500 }, // of the canvas, as last resized
     last_t: Date.now(),
     mouse: {
       x: 0, y: 0,
@@ -443,6 +453,7 @@ const workerfn = () => {
     init: (width, height, title) => {
       p.init.width = width;
       p.init.height = height;
+      p.size = { width, height };
       p.init.title = takeString(title);
     },
     log: function(txt) {
@@ -541,7 +552,13 @@ const workerfn = () => {
     key_down: (t, k) => {
       return p.keyboard.down.includes(String.fromCodePoint(t, k)) ? 1 : 0;
     },
-    wait_queue: () => { }
+    wait_queue: () => { },
+    window_size: (width_ptr, height_ptr) => {
+      const view = new DataView(p.instance.exports.memory.buffer);
+      view.setInt32(width_ptr, p.size.width, true);
+      view.setInt32(height_ptr, p.size.height, true);
+      return 0;
+    },
   };
 
   const utf8Decoder = new TextDecoder("utf-8");
@@ -612,6 +629,8 @@ const workerfn = () => {
           p.mouse.down = false;
         } else if (event.data.type == 'event/keydown') {
           p.keyboard.down.push(event.data.key);
+        } else if (event.data.type == 'event/resize') {
+          p.size = { width: event.data.size[0], height: event.data.size[1] };
         } else if (event.data.type == 'event/keyup') {
           p.keyboard.down = p.keyboard.down.filter(k => k != event.data.key);
         }
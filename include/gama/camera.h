@@ -0,0 +1,131 @@
+/**
+ * @file camera.h
+ * @brief A 2D camera, pan and zoom, applied by every gm_draw_* call.
+ *
+ * A world point p is drawn at (p - center) * zoom on the screen, whose
+ * shorter side spans [-1, 1]: x in [-aspect, aspect] on a wide window, y in
+ * [-1 / aspect, 1 / aspect] on a tall one. Positions and sizes (width,
+ * height, radius) go through the camera; line thickness and text height are
+ * pen sizes and stay in screen units. UI drawn over a scene switches back to
+ * gm_camera_identity first. gm_mouse stays in screen coordinates,
+ * gm_camera_to_world() maps it into the scene.
+ */
+
+#pragma once
+
+#include "gapi.h"
+#include "position.h"
+
+/**
+ * @brief The world point at the center of the screen, and the scale.
+ */
+typedef struct {
+  double x, y;  /**< World coordinates of the screen center */
+  double zoom;  /**< Screen units per world unit */
+} gmCamera;
+
+/** @brief The camera that leaves coordinates as they are. */
+const gmCamera gm_camera_identity = {0, 0, 1};
+
+/** @brief The camera used by the gm_draw_* functions. */
+gmCamera gm_camera = {0, 0, 1};
+
+// width over height of the window, from gm_init() until the backend can
+// report the size
+double _gm_aspect = 1.6;
+
+/**
+ * @brief How elongated a window gm_camera_bounds() allows for, either way,
+ * when the backend cannot report its size.
+ */
+#ifndef GM_ASPECT_MAX
+#define GM_ASPECT_MAX 3
+#endif
+
+/**
+ * @brief Switches the camera used for drawing.
+ * @param camera The new camera.
+ * @return The camera used until now, to restore it later.
+ */
+gmCamera gm_camera_set(gmCamera camera) {
+  gmCamera previous = gm_camera;
+  gm_camera = camera;
+  return previous;
+}
+
+static inline int gm_camera_is_identity() {
+  return gm_camera.x == 0 && gm_camera.y == 0 && gm_camera.zoom == 1;
+}
+
+static inline double gm_camera_x(double x) {
+  return (x - gm_camera.x) * gm_camera.zoom;
+}
+
+static inline double gm_camera_y(double y) {
+  return (y - gm_camera.y) * gm_camera.zoom;
+}
+
+static inline double gm_camera_length(double length) {
+  return length * gm_camera.zoom;
+}
+
+/**
+ * @brief Maps a screen position, such as gm_mouse.position, to the world.
+ * @param screen The position on the screen.
+ * @return The world position drawn there.
+ */
+static inline gmPos gm_camera_to_world(gmPos screen) {
+  return (gmPos){screen.x / gm_camera.zoom + gm_camera.x,
+                 screen.y / gm_camera.zoom + gm_camera.y};
+}
+
+/**
+ * @brief Width over height of the window as the backend reports it, 0 when
+ * it cannot.
+ */
+double gm_window_aspect() {
+  int32_t width = 0, height = 0;
+  if (gapi_has(gapi_window_size) && gapi_window_size(&width, &height) == 0 &&
+      width > 0 && height > 0)
+    return (double)width / height;
+  return 0;
+}
+
+/**
+ * @brief Width over height of the window, the one asked of gm_init() when
+ * the backend cannot report it.
+ */
+double gm_screen_aspect() {
+  double aspect = gm_window_aspect();
+  return aspect > 0 ? aspect : _gm_aspect;
+}
+
+/**
+ * @brief The world rectangle visible through the camera.
+ *
+ * Without the window size from the backend, a fullscreen or resized window
+ * can have any shape, so the rectangle covers every window up to
+ * GM_ASPECT_MAX wide or tall: culling to it never hides what is on screen.
+ *
+ * @param left Set to the smallest visible x.
+ * @param bottom Set to the smallest visible y.
+ * @param right Set to the largest visible x.
+ * @param top Set to the largest visible y.
+ */
+void gm_camera_bounds(double *left, double *bottom, double *right,
+                      double *top) {
+  double aspect = gm_window_aspect();
+  double half_width = 1 / gm_camera.zoom, half_height = half_width;
+  if (aspect == 0) {
+    half_width *= GM_ASPECT_MAX;
+    half_height *= GM_ASPECT_MAX;
+  } else if (aspect > 1) {
+    half_width *= aspect;
+  } else {
+    half_height /= aspect;
+  }
+  *left = gm_camera.x - half_width;
+  *right = gm_camera.x + half_width;
+  *bottom = gm_camera.y - half_height;
+  *top = gm_camera.y + half_height;
+}
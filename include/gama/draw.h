@@ -4,16 +4,18 @@
  *
  * This file provides a set of functions for immediate-mode rendering of
  * various primitives, as well as helper functions to draw physics bodies
- * (`gmBody`). All coordinates are in world space.
+ * (`gmBody`). All coordinates are in world space, drawn through gm_camera.
  */
 
 #pragma once
 
 #include "body.h"
+#include "camera.h"
 #include "color.h"
 #include "gapi.h"
 #include "image.h" // For gmImage
 #include <stdint.h>
+#include <string.h>
 
 // ---------------------------------------------------------------------------
 // ------------------------- Immediate-Mode Primitives -----------------------
@@ -31,7 +33,8 @@
  */
 int32_t gm_draw_line(double x1, double y1, double x2, double y2,
                      double thickness, gmColor c) {
-  return gapi_draw_line(x1, y1, x2, y2, thickness, gm_red(c), gm_green(c),
+  return gapi_draw_line(gm_camera_x(x1), gm_camera_y(y1), gm_camera_x(x2),
+                        gm_camera_y(y2), thickness, gm_red(c), gm_green(c),
                         gm_blue(c), gm_alpha(c));
 }
 
@@ -45,7 +48,8 @@ int32_t gm_draw_line(double x1, double y1, double x2, double y2,
  * @return An identifier for the drawing command.
  */
 int32_t gm_draw_rectangle(double x, double y, double w, double h, gmColor c) {
-  return gapi_draw_rect(x, y, w, h, gm_red(c), gm_green(c), gm_blue(c),
+  return gapi_draw_rect(gm_camera_x(x), gm_camera_y(y), gm_camera_length(w),
+                        gm_camera_length(h), gm_red(c), gm_green(c), gm_blue(c),
                         gm_alpha(c));
 }
 
@@ -61,7 +65,9 @@ int32_t gm_draw_rectangle(double x, double y, double w, double h, gmColor c) {
  */
 int32_t gm_draw_rounded_rectangle(double x, double y, double w, double h,
                                   double r, gmColor c) {
-  return gapi_draw_rounded_rect(x, y, w, h, r, gm_red(c), gm_green(c),
+  return gapi_draw_rounded_rect(gm_camera_x(x), gm_camera_y(y),
+                                gm_camera_length(w), gm_camera_length(h),
+                                gm_camera_length(r), gm_red(c), gm_green(c),
                                 gm_blue(c), gm_alpha(c));
 }
 
@@ -75,7 +81,8 @@ int32_t gm_draw_rounded_rectangle(double x, double y, double w, double h,
  */
 int32_t gm_draw_circle(double center_x, double center_y, double radius,
                        gmColor c) {
-  return gapi_draw_circle(center_x, center_y, radius, gm_red(c), gm_green(c),
+  return gapi_draw_circle(gm_camera_x(center_x), gm_camera_y(center_y),
+                          gm_camera_length(radius), gm_red(c), gm_green(c),
                           gm_blue(c), gm_alpha(c));
 }
 
@@ -89,8 +96,9 @@ int32_t gm_draw_circle(double center_x, double center_y, double radius,
  * @return An identifier for the drawing command.
  */
 int32_t gm_draw_ellipse(double x, double y, double w, double h, gmColor c) {
-  return gapi_draw_ellipse(x, y, w, h, gm_red(c), gm_green(c), gm_blue(c),
-                           gm_alpha(c));
+  return gapi_draw_ellipse(gm_camera_x(x), gm_camera_y(y), gm_camera_length(w),
+                           gm_camera_length(h), gm_red(c), gm_green(c),
+                           gm_blue(c), gm_alpha(c));
 }
 
 /**
@@ -106,8 +114,9 @@ int32_t gm_draw_ellipse(double x, double y, double w, double h, gmColor c) {
  */
 int32_t gm_draw_triangle(double x1, double y1, double x2, double y2, double x3,
                          double y3, gmColor c) {
-  return gapi_draw_triangle(x1, y1, x2, y2, x3, y3, gm_red(c), gm_green(c),
-                            gm_blue(c), gm_alpha(c));
+  return gapi_draw_triangle(gm_camera_x(x1), gm_camera_y(y1), gm_camera_x(x2),
+                            gm_camera_y(y2), gm_camera_x(x3), gm_camera_y(y3),
+                            gm_red(c), gm_green(c), gm_blue(c), gm_alpha(c));
 }
 
 /**
@@ -120,10 +129,96 @@ int32_t gm_draw_triangle(double x1, double y1, double x2, double y2, double x3,
  * @return An identifier for the drawing command.
  */
 int32_t gm_draw_image(gmImage img, double x, double y, double w, double h) {
-  return gapi_draw_image(img.handle, x, y, w, h);
+  return gapi_draw_image(img.handle, gm_camera_x(x), gm_camera_y(y),
+                         gm_camera_length(w), gm_camera_length(h));
+}
+
+// ---------------------------------------------------------------------------
+// -------------------------------- Text Runs --------------------------------
+// ---------------------------------------------------------------------------
+// Strings drawn again and again (labels, captions) are laid out once by the
+// backend and drawn by handle after that. Runs live in a two-way set
+// associative table keyed by a hash of the text, font, size and style; the
+// color is not part of the key. A string only gets a run the second time it
+// is seen, so text that changes every frame costs no more than before, and
+// misses replace such one-off strings before the least recently used run.
+
+#ifndef GM_TEXT_RUNS
+#define GM_TEXT_RUNS 512 // slots, a power of two, two per set
+#endif
+#define GM_TEXT_RUN_MAX 64 // longer strings are drawn directly
+#define GM_TEXT_FONT_MAX 32
+
+typedef struct {
+  uint64_t hash;
+  uint32_t run;  // 0 while seen once
+  uint64_t used; // _gm_text_clock at the last lookup
+  double size;
+  uint8_t style;
+  char text[GM_TEXT_RUN_MAX];
+  char font[GM_TEXT_FONT_MAX];
+} _gmTextRun;
+
+_gmTextRun _gm_text_runs[GM_TEXT_RUNS];
+uint64_t _gm_text_clock = 0;
+
+// FNV-1a over the strings, then the size and style
+static inline uint64_t _gm_text_hash(const char *text, const char *font,
+                                     double size, uint8_t style) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (const char *p = text; *p; p++)
+    h = (h ^ (uint8_t)*p) * 0x100000001b3ull;
+  h = (h ^ 0xff) * 0x100000001b3ull;
+  for (const char *p = font; *p; p++)
+    h = (h ^ (uint8_t)*p) * 0x100000001b3ull;
+  uint64_t bits;
+  memcpy(&bits, &size, sizeof(bits));
+  return (h ^ bits ^ style) * 0x100000001b3ull;
+}
+
+// the run for this text, 0 when it must be drawn directly
+static uint32_t _gm_text_run(const char *text, const char *font, double size,
+                             uint8_t style) {
+  size_t text_len = strlen(text), font_len = strlen(font);
+  if (text_len >= GM_TEXT_RUN_MAX || font_len >= GM_TEXT_FONT_MAX)
+    return 0;
+  uint64_t hash = _gm_text_hash(text, font, size, style);
+  _gmTextRun *set = &_gm_text_runs[(hash & (GM_TEXT_RUNS / 2 - 1)) * 2];
+  _gmTextRun *slot = NULL;
+  for (int way = 0; way < 2 && slot == NULL; way++)
+    if (set[way].hash == hash && set[way].size == size &&
+        set[way].style == style && strcmp(set[way].text, text) == 0 &&
+        strcmp(set[way].font, font) == 0)
+      slot = &set[way];
+  _gm_text_clock++;
+  if (slot == NULL) {
+    // the least recently used way, an empty one (used 0) first: a run or
+    // not, an entry seen once must survive a colliding string drawn in
+    // between to be promoted on its next frame
+    slot = set[1].used < set[0].used ? &set[1] : &set[0];
+    if (slot->run != 0)
+      gapi_free_text_run(slot->run);
+    slot->hash = hash;
+    slot->run = 0;
+    slot->used = _gm_text_clock;
+    slot->size = size;
+    slot->style = style;
+    memcpy(slot->text, text, text_len + 1);
+    memcpy(slot->font, font, font_len + 1);
+    return 0;
+  }
+  slot->used = _gm_text_clock;
+  if (slot->run == 0)
+    slot->run = gapi_create_text_run(size, text, font, style);
+  return slot->run;
 }
+
 /**
  * @brief Draws text.
+ *
+ * Strings drawn on several frames are laid out once and reused, when the
+ * backend supports text runs.
+ *
  * @param x The x-coordinate for the text position.
  * @param y The y-coordinate for the text position.
  * @param text The null-terminated string to draw.
@@ -134,8 +229,135 @@ int32_t gm_draw_image(gmImage img, double x, double y, double w, double h) {
  */
 int32_t gm_draw_text(double x, double y, const char *text, const char *font,
                      double font_size, gmColor c) {
-  return gapi_draw_text(x, y, font_size, text, font, 0, gm_red(c), gm_green(c),
-                        gm_blue(c), gm_alpha(c));
+  if (gapi_has(gapi_create_text_run)) {
+    uint32_t run = _gm_text_run(text, font, font_size, 0);
+    if (run != 0)
+      return gapi_draw_text_run(run, gm_camera_x(x), gm_camera_y(y), gm_red(c),
+                                gm_green(c), gm_blue(c), gm_alpha(c));
+  }
+  return gapi_draw_text(gm_camera_x(x), gm_camera_y(y), font_size, text, font,
+                        0, gm_red(c), gm_green(c), gm_blue(c), gm_alpha(c));
+}
+
+// ---------------------------------------------------------------------------
+// ------------------------------ Batched Primitives -------------------------
+// ---------------------------------------------------------------------------
+// One backend call for many primitives of the same color. Backends without
+// the batch entry points get one call per primitive instead.
+
+// primitives per chunk when a batch goes through a camera, the transformed
+// copy lives on the stack
+#define _GM_BATCH_CHUNK 256
+
+static int32_t _gm_lines(const float *xy, size_t count, double thickness,
+                         gmColor c) {
+  if (gapi_has(gapi_draw_lines))
+    return gapi_draw_lines(xy, count, thickness, gm_red(c), gm_green(c),
+                           gm_blue(c), gm_alpha(c));
+  int32_t id = 0;
+  for (size_t i = 0; i < count; i++, xy += 4)
+    id = gapi_draw_line(xy[0], xy[1], xy[2], xy[3], thickness, gm_red(c),
+                        gm_green(c), gm_blue(c), gm_alpha(c));
+  return id;
+}
+
+static int32_t _gm_circles(const float *xyr, size_t count, gmColor c) {
+  if (gapi_has(gapi_draw_circles))
+    return gapi_draw_circles(xyr, count, gm_red(c), gm_green(c), gm_blue(c),
+                             gm_alpha(c));
+  int32_t id = 0;
+  for (size_t i = 0; i < count; i++, xyr += 3)
+    id = gapi_draw_circle(xyr[0], xyr[1], xyr[2], gm_red(c), gm_green(c),
+                          gm_blue(c), gm_alpha(c));
+  return id;
+}
+
+static int32_t _gm_rects(const float *xywh, size_t count, gmColor c) {
+  if (gapi_has(gapi_draw_rects))
+    return gapi_draw_rects(xywh, count, gm_red(c), gm_green(c), gm_blue(c),
+                           gm_alpha(c));
+  int32_t id = 0;
+  for (size_t i = 0; i < count; i++, xywh += 4)
+    id = gapi_draw_rect(xywh[0], xywh[1], xywh[2], xywh[3], gm_red(c),
+                        gm_green(c), gm_blue(c), gm_alpha(c));
+  return id;
+}
+
+/**
+ * @brief Draws many line segments of the same thickness and color.
+ * @param xy The segments, 4 floats each: x1, y1, x2, y2.
+ * @param count The number of segments.
+ * @param thickness The thickness of the lines in pixels.
+ * @param c The color of the lines.
+ * @return An identifier for the drawing command.
+ */
+int32_t gm_draw_lines_batch(const float *xy, size_t count, double thickness,
+                            gmColor c) {
+  if (gm_camera_is_identity())
+    return _gm_lines(xy, count, thickness, c);
+  float chunk[4 * _GM_BATCH_CHUNK];
+  int32_t id = 0;
+  for (size_t done = 0; done < count; done += _GM_BATCH_CHUNK) {
+    size_t m = count - done < _GM_BATCH_CHUNK ? count - done : _GM_BATCH_CHUNK;
+    for (size_t i = 0; i < 2 * m; i++) {
+      chunk[2 * i] = gm_camera_x(xy[4 * done + 2 * i]);
+      chunk[2 * i + 1] = gm_camera_y(xy[4 * done + 2 * i + 1]);
+    }
+    id = _gm_lines(chunk, m, thickness, c);
+  }
+  return id;
+}
+
+/**
+ * @brief Draws many circles of the same color.
+ * @param xyr The circles, 3 floats each: center x, center y, radius.
+ * @param count The number of circles.
+ * @param c The color of the circles.
+ * @return An identifier for the drawing command.
+ */
+int32_t gm_draw_circles_batch(const float *xyr, size_t count, gmColor c) {
+  if (gm_camera_is_identity())
+    return _gm_circles(xyr, count, c);
+  float chunk[3 * _GM_BATCH_CHUNK];
+  int32_t id = 0;
+  for (size_t done = 0; done < count; done += _GM_BATCH_CHUNK) {
+    size_t m = count - done < _GM_BATCH_CHUNK ? count - done : _GM_BATCH_CHUNK;
+    const float *in = xyr + 3 * done;
+    for (size_t i = 0; i < m; i++) {
+      chunk[3 * i] = gm_camera_x(in[3 * i]);
+      chunk[3 * i + 1] = gm_camera_y(in[3 * i + 1]);
+      chunk[3 * i + 2] = gm_camera_length(in[3 * i + 2]);
+    }
+    id = _gm_circles(chunk, m, c);
+  }
+  return id;
+}
+
+/**
+ * @brief Draws many rectangles of the same color.
+ * @param xywh The rectangles, 4 floats each: x, y, width, height, placed as
+ *             in gm_draw_rectangle().
+ * @param count The number of rectangles.
+ * @param c The color of the rectangles.
+ * @return An identifier for the drawing command.
+ */
+int32_t gm_draw_rects_batch(const float *xywh, size_t count, gmColor c) {
+  if (gm_camera_is_identity())
+    return _gm_rects(xywh, count, c);
+  float chunk[4 * _GM_BATCH_CHUNK];
+  int32_t id = 0;
+  for (size_t done = 0; done < count; done += _GM_BATCH_CHUNK) {
+    size_t m = count - done < _GM_BATCH_CHUNK ? count - done : _GM_BATCH_CHUNK;
+    const float *in = xywh + 4 * done;
+    for (size_t i = 0; i < m; i++) {
+      chunk[4 * i] = gm_camera_x(in[4 * i]);
+      chunk[4 * i + 1] = gm_camera_y(in[4 * i + 1]);
+      chunk[4 * i + 2] = gm_camera_length(in[4 * i + 2]);
+      chunk[4 * i + 3] = gm_camera_length(in[4 * i + 3]);
+    }
+    id = _gm_rects(chunk, m, c);
+  }
+  return id;
 }
 
 // ---------------------------------------------------------------------------
@@ -15,6 +15,7 @@
 
 #include "draw.h"
 #include "gapi.h"
+#include "layer.h"
 #include "stdio.h"
 #include "widgets/frame.h"
 
@@ -120,21 +121,21 @@ void _gm_fps() {
   static double _fps = 0;
   static double dt = 1;
   static double _display_fps = 0;
+  static char fps_text[20] = "fps: 0";
   dt += gm_dt();
   double fps = 1 / gm_dt();
   if (_fps == 0)
     _fps = 60;
   else
     _fps = (_fps * alpha) + (fps * (1 - alpha));
+  // the text only changes twice a second, format it then
   if (dt >= 0.5) {
     dt = 0;
     _display_fps = _fps;
+    snprintf(fps_text, sizeof(fps_text), "fps: %d", (int)_display_fps);
   }
 
   if (__gm_show_fps) {
-    char fps_text[20] = {0}; // ERROR: use fps
-    // snprintf(fps_text, sizeof(fps_text), "fps: %.2lf", _display_fps);
-    snprintf(fps_text, sizeof(fps_text), "fps: %d", (int)_display_fps);
     gmw_frame(0.9, -0.9, 0.4, 0.1);
     gm_draw_text(0.9, -0.9, fps_text, "", 0.1, GM_WHITE);
   }
@@ -209,6 +210,8 @@ void gm_resize(int width, int height) { return gapi_resize(width, height); }
  */
 void gm_init(int width, int height, const char *title) {
   int code = gapi_init(width, height, title);
+  if (width > 0 && height > 0)
+    _gm_aspect = (double)width / height;
   char msg[100];
 
   if (code != 0) {
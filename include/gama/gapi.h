@@ -11,6 +11,37 @@ double _gm_t = 0;
 static inline double gm_dt() { return _gm_dt; }
 static inline double gm_t() { return _gm_t; }
 
+// Entry points marked GAPI_EXT are optional: a backend may not implement
+// them. Natively they are weak symbols, NULL when missing, so callers test
+// gapi_has(fn) and fall back to the core primitives. A wasm import cannot be
+// probed: the web build lists below what build/web/gama.js provides, and
+// -DGAPI_WEB_EXT=1 enables the rest once the host provides them. The
+// prebuilt build/native/libvgama.so exports none of them yet, so what they
+// save only shows once the backend implements them; tools/frames.c measures
+// both cases.
+#ifdef __ZIG_CC__
+#define GAPI_EXT
+#ifndef GAPI_WEB_EXT
+#define GAPI_WEB_EXT 0
+#endif
+#define gapi_has(fn) (GAPI_WEB_EXT || _GAPI_WEB_HAS_##fn)
+#define _GAPI_WEB_HAS_gapi_draw_lines 0
+#define _GAPI_WEB_HAS_gapi_draw_circles 0
+#define _GAPI_WEB_HAS_gapi_draw_rects 0
+#define _GAPI_WEB_HAS_gapi_create_image_rgba 0
+#define _GAPI_WEB_HAS_gapi_update_image_rgba 0
+#define _GAPI_WEB_HAS_gapi_create_layer 0
+#define _GAPI_WEB_HAS_gapi_begin_layer 0
+#define _GAPI_WEB_HAS_gapi_end_layer 0
+#define _GAPI_WEB_HAS_gapi_window_size 1
+#define _GAPI_WEB_HAS_gapi_create_text_run 0
+#define _GAPI_WEB_HAS_gapi_draw_text_run 0
+#define _GAPI_WEB_HAS_gapi_free_text_run 0
+#else
+#define GAPI_EXT __attribute__((weak))
+#define gapi_has(fn) ((fn) != NULL)
+#endif
+
 extern void
 #ifdef __ZIG_CC__
     __attribute__((import_module("gapi"), import_name("set_title")))
@@ -110,6 +141,30 @@ extern int32_t
                        double y3, uint8_t cr, uint8_t cg, uint8_t cb,
                        uint8_t ca);
 
+// Batches: count primitives in one call, all of the same color. Coordinates
+// are packed floats, per primitive x1 y1 x2 y2 for lines, x y radius for
+// circles and x y w h for rectangles.
+extern int32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("draw_lines")))
+#endif
+    gapi_draw_lines(const float *xy, uint32_t count, double thickness,
+                    uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+
+extern int32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("draw_circles")))
+#endif
+    gapi_draw_circles(const float *xyr, uint32_t count, uint8_t r, uint8_t g,
+                      uint8_t b, uint8_t a);
+
+extern int32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("draw_rects")))
+#endif
+    gapi_draw_rects(const float *xywh, uint32_t count, uint8_t r, uint8_t g,
+                    uint8_t b, uint8_t a);
+
 // --- Image Functions ---
 extern uint32_t
 #ifdef __ZIG_CC__
@@ -131,6 +186,53 @@ extern int32_t
                          uint32_t slice_width, uint32_t slice_height, double x,
                          double y, double width, double height);
 
+// RGBA8 pixels, rows from the top, copied by the backend. Returns a handle
+// for gapi_draw_image, 0 on failure.
+extern uint32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("create_image_rgba")))
+#endif
+    gapi_create_image_rgba(const uint8_t *pixels, uint32_t width,
+                           uint32_t height);
+
+extern int32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("update_image_rgba")))
+#endif
+    gapi_update_image_rgba(uint32_t handle, const uint8_t *pixels,
+                           uint32_t width, uint32_t height);
+
+// --- Layer Functions ---
+// A layer is an offscreen image that draw calls can be redirected into. Its
+// handle is drawn with gapi_draw_image like any other image.
+extern uint32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("create_layer")))
+#endif
+    gapi_create_layer();
+
+// clears the layer, sized to cover the world rectangle at the current window
+// resolution, and sends the following draw calls into it. 0 on success.
+extern int32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("begin_layer")))
+#endif
+    gapi_begin_layer(uint32_t handle, double x, double y, double width,
+                     double height);
+
+extern int32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("end_layer")))
+#endif
+    gapi_end_layer();
+
+// the drawable size of the window in pixels
+extern int32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("window_size")))
+#endif
+    gapi_window_size(int32_t *width, int32_t *height);
+
 // --- Text Functions ---
 extern int32_t
 #ifdef __ZIG_CC__
@@ -140,6 +242,28 @@ extern int32_t
                    const char *font, uint8_t style, uint8_t cr, uint8_t cg,
                    uint8_t cb, uint8_t ca);
 
+// Text runs: a string laid out once by the backend, then drawn by handle
+// without crossing the string or shaping it again. 0 on failure.
+extern uint32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("create_text_run")))
+#endif
+    gapi_create_text_run(double height, const char *txt, const char *font,
+                         uint8_t style);
+
+extern int32_t GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("draw_text_run")))
+#endif
+    gapi_draw_text_run(uint32_t run, double x, double y, uint8_t cr,
+                       uint8_t cg, uint8_t cb, uint8_t ca);
+
+extern void GAPI_EXT
+#ifdef __ZIG_CC__
+    __attribute__((import_module("gapi"), import_name("free_text_run")))
+#endif
+    gapi_free_text_run(uint32_t run);
+
 // --- Event Functions ---
 extern int32_t
 #ifdef __ZIG_CC__
@@ -0,0 +1,636 @@
+/**
+ * @file gapi_stub.h
+ * @brief A headless gapi backend that records draw commands and replays
+ * scripted input.
+ *
+ * Including this file in exactly one translation unit of a native program
+ * defines every gapi_* function, the optional ones included, so the program
+ * links and runs without the prebuilt backend, a window or a GPU. Nothing is
+ * drawn: each command is appended to a compact log of the current frame,
+ * and counted per type with its primitives and bytes. Input comes from a
+ * script, see gapi_stub_script(). The clock is fixed at 60 frames per second
+ * so runs are repeatable, and the real time spent between frames is
+ * measured, see gapi_stub_frame_ms().
+ *
+ * A backend without some optional entry points is mimicked by leaving them
+ * out: define GAPI_STUB_NO_BATCH before the include and the batch calls stay
+ * unresolved, so gama falls back to one core call per primitive as it does
+ * on the prebuilt backend. GAPI_STUB_NO_LAYERS likewise leaves out the
+ * offscreen layers, whose contents are then drawn again every frame, and
+ * GAPI_STUB_NO_TEXT_RUNS the text runs, so every label is sent and laid out
+ * anew.
+ *
+ * @code
+ * #include <gama/gapi_stub.h>
+ *
+ * int main(void) {
+ *   gapi_stub_frames(600);
+ *   setup();
+ *   while (_gm_loop())
+ *     loop();
+ *   printf("%.3f ms\n", gapi_stub_frame_ms(0.5));
+ * }
+ * @endcode
+ */
+
+#pragma once
+
+#ifdef __ZIG_CC__
+#error "gapi_stub.h is a native backend, the web build has its host's"
+#endif
+
+#include "gapi.h"
+#include "key.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef GAPI_STUB_LOG
+/** @brief Bytes of commands kept per frame, the rest are only counted. */
+#define GAPI_STUB_LOG (1 << 20)
+#endif
+#ifndef GAPI_STUB_MAX_FRAMES
+/** @brief Frames whose time is kept for the percentiles. */
+#define GAPI_STUB_MAX_FRAMES (1 << 17)
+#endif
+#ifndef GAPI_STUB_EVENTS
+/** @brief Lines of input script kept. */
+#define GAPI_STUB_EVENTS 4096
+#endif
+#define GAPI_STUB_KEYS 32
+
+/**
+ * @brief The commands recorded, one byte in the log before their arguments.
+ */
+typedef enum {
+  GAPI_STUB_LINE,
+  GAPI_STUB_RECT,
+  GAPI_STUB_ROUNDED_RECT,
+  GAPI_STUB_CIRCLE,
+  GAPI_STUB_ELLIPSE,
+  GAPI_STUB_TRIANGLE,
+  GAPI_STUB_LINES,
+  GAPI_STUB_CIRCLES,
+  GAPI_STUB_RECTS,
+  GAPI_STUB_IMAGE,
+  GAPI_STUB_IMAGE_PART,
+  GAPI_STUB_TEXT,
+  GAPI_STUB_TEXT_RUN,
+  GAPI_STUB_BEGIN_LAYER,
+  GAPI_STUB_END_LAYER,
+  GAPI_STUB_OPS,
+} gapiStubOp;
+
+/** @brief Names of the gapiStubOp values, for reports. */
+const char *const gapi_stub_op_names[GAPI_STUB_OPS] = {
+    "line",  "rect",  "rounded_rect", "circle",     "ellipse",
+    "triangle", "lines", "circles",   "rects",      "image",
+    "image_part", "text", "text_run", "begin_layer", "end_layer",
+};
+
+/**
+ * @brief What one command type added up to over the run.
+ */
+typedef struct {
+  unsigned long calls;      /**< gapi calls */
+  unsigned long primitives; /**< shapes drawn, more than calls for batches */
+  unsigned long bytes;      /**< log bytes, the arguments as recorded */
+} gapiStubTally;
+
+typedef enum {
+  _GAPI_STUB_MOUSE,
+  _GAPI_STUB_DOWN,
+  _GAPI_STUB_UP,
+  _GAPI_STUB_KEY,
+  _GAPI_STUB_RELEASE,
+  _GAPI_STUB_RESIZE,
+  _GAPI_STUB_QUIT,
+} _gapiStubEventKind;
+
+typedef struct {
+  long frame;
+  _gapiStubEventKind kind;
+  double x, y;
+  char t, k;
+} _gapiStubEvent;
+
+struct {
+  long frames, max_frames; // frames started, and after which to stop
+  int quit;
+  int32_t width, height;
+  double mouse_x, mouse_y;
+  int mouse_down;
+  char keys[GAPI_STUB_KEYS][2]; // held, as gapi_key_down() pairs
+  int keys_n;
+  _gapiStubEvent events[GAPI_STUB_EVENTS];
+  int events_n, event;
+  uint32_t handles; // images, layers and text runs share them
+  long text_runs;   // alive
+  int layer;        // recording into a layer
+  uint8_t log[GAPI_STUB_LOG];
+  size_t log_size;
+  long overflows; // frames whose log did not fit
+  int overflowed;
+  gapiStubTally tally[GAPI_STUB_OPS];
+  struct timespec start, frame_start, cpu_start;
+  double setup_ms, cpu_ms;
+  double times[GAPI_STUB_MAX_FRAMES]; // ms per frame
+} gapi_stub = {.max_frames = 300};
+
+/**
+ * @brief Sets how many frames run before gapi_yield() reports the end.
+ * @param frames The number of calls to loop().
+ */
+void gapi_stub_frames(long frames) { gapi_stub.max_frames = frames; }
+
+/**
+ * @brief Sets the window size, instead of the one asked by gm_init().
+ * @param width The width in pixels.
+ * @param height The height in pixels.
+ */
+void gapi_stub_window(int32_t width, int32_t height) {
+  gapi_stub.width = width;
+  gapi_stub.height = height;
+}
+
+/**
+ * @brief Loads input to replay.
+ *
+ * One event per line, before the given frame of loop() (from 0); state set
+ * by an event holds until changed. Keys are named as for gm_key(), with
+ * "space" for ' '. A '#' starts a comment.
+ *
+ * @code
+ * 10 mouse 0.2 0.3    # move the pointer
+ * 10 down             # press the button
+ * 12 up
+ * 20 key =            # hold a key
+ * 80 release =
+ * 90 resize 1280 720
+ * 200 quit
+ * @endcode
+ *
+ * @param path The script file.
+ * @return The number of events, or -1 if the file could not be read or a
+ * line was not understood.
+ */
+int gapi_stub_script(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+    return -1;
+  char line[256];
+  int bad = 0;
+  gapi_stub.events_n = 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    char *hash = strchr(line, '#');
+    if (hash != NULL)
+      *hash = 0;
+    char name[16], arg[16];
+    _gapiStubEvent e = {0};
+    int got = sscanf(line, "%ld %15s %15s", &e.frame, name, arg);
+    if (got <= 0)
+      continue;
+    if (got < 2 || gapi_stub.events_n == GAPI_STUB_EVENTS) {
+      bad = 1;
+      break;
+    }
+    if (strcmp(name, "mouse") == 0) {
+      e.kind = _GAPI_STUB_MOUSE;
+      bad = sscanf(line, "%*d %*s %lf %lf", &e.x, &e.y) != 2;
+    } else if (strcmp(name, "down") == 0) {
+      e.kind = _GAPI_STUB_DOWN;
+    } else if (strcmp(name, "up") == 0) {
+      e.kind = _GAPI_STUB_UP;
+    } else if (strcmp(name, "key") == 0 || strcmp(name, "release") == 0) {
+      e.kind = name[0] == 'k' ? _GAPI_STUB_KEY : _GAPI_STUB_RELEASE;
+      bad = got < 3;
+      gm_decode_key_shortcut(strcmp(arg, "space") == 0 ? ' ' : arg[0], &e.t,
+                             &e.k);
+    } else if (strcmp(name, "resize") == 0) {
+      e.kind = _GAPI_STUB_RESIZE;
+      bad = sscanf(line, "%*d %*s %lf %lf", &e.x, &e.y) != 2 || e.x < 1 ||
+            e.y < 1;
+    } else if (strcmp(name, "quit") == 0) {
+      e.kind = _GAPI_STUB_QUIT;
+    } else {
+      bad = 1;
+    }
+    if (bad)
+      break;
+    // in frame order, events of a frame in script order
+    int i = gapi_stub.events_n++;
+    for (; i > 0 && gapi_stub.events[i - 1].frame > e.frame; i--)
+      gapi_stub.events[i] = gapi_stub.events[i - 1];
+    gapi_stub.events[i] = e;
+  }
+  fclose(f);
+  if (bad)
+    return -1;
+  return gapi_stub.events_n;
+}
+
+/**
+ * @brief The commands of the frame running, or of the last one after the
+ * run, as recorded.
+ *
+ * Each starts with its gapiStubOp byte, followed by its arguments: floats
+ * for coordinates and sizes, 4 bytes of color, 32 bit counts and handles,
+ * and text as a 16 bit length then its bytes. Everything is native endian.
+ *
+ * @param size Set to the number of bytes.
+ * @return The log, cleared by gapi_yield() as the next frame starts.
+ */
+const uint8_t *gapi_stub_log(size_t *size) {
+  *size = gapi_stub.log_size;
+  return gapi_stub.log;
+}
+
+static double _gapi_stub_ms(struct timespec from, struct timespec to) {
+  return (to.tv_sec - from.tv_sec) * 1e3 + (to.tv_nsec - from.tv_nsec) / 1e6;
+}
+
+static int _gapi_stub_time_cmp(const void *a, const void *b) {
+  double ta = *(const double *)a, tb = *(const double *)b;
+  return (ta > tb) - (ta < tb);
+}
+
+/**
+ * @brief Wall time of a frame at a given rank, once the frames have run.
+ *
+ * Only the first GAPI_STUB_MAX_FRAMES frames are ranked. Sorts the times
+ * in place, call it after the run.
+ *
+ * @param rank 0 for the fastest frame, 0.5 for the median, 1 for the
+ * slowest.
+ * @return The time in milliseconds, 0 when no frame ran.
+ */
+double gapi_stub_frame_ms(double rank) {
+  long n = gapi_stub.frames;
+  if (n > GAPI_STUB_MAX_FRAMES)
+    n = GAPI_STUB_MAX_FRAMES;
+  if (n <= 0)
+    return 0;
+  qsort(gapi_stub.times, n, sizeof(double), _gapi_stub_time_cmp);
+  return gapi_stub.times[(long)(rank * (n - 1) + 0.5)];
+}
+
+// once a command does not fit, the rest of the frame is only counted
+static void _gapi_stub_put(const void *data, size_t size) {
+  if (gapi_stub.overflowed || gapi_stub.log_size + size > GAPI_STUB_LOG) {
+    gapi_stub.overflowed = 1;
+    return;
+  }
+  memcpy(gapi_stub.log + gapi_stub.log_size, data, size);
+  gapi_stub.log_size += size;
+}
+
+static void _gapi_stub_record(gapiStubOp op, size_t primitives,
+                              const void *args, size_t size,
+                              const void *extra, size_t extra_size) {
+  uint8_t byte = op;
+  _gapi_stub_put(&byte, 1);
+  _gapi_stub_put(args, size);
+  if (extra_size > 0)
+    _gapi_stub_put(extra, extra_size);
+  gapiStubTally *t = &gapi_stub.tally[op];
+  t->calls++;
+  t->primitives += primitives;
+  t->bytes += 1 + size + extra_size;
+}
+
+// arguments as laid out in the log
+typedef struct {
+  float v[6];
+  uint8_t rgba[4];
+} _gapiStubShape;
+
+static int32_t _gapi_stub_shape(gapiStubOp op, int floats, const double *v,
+                                uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+  _gapiStubShape s = {.rgba = {r, g, b, a}};
+  for (int i = 0; i < floats; i++)
+    s.v[i] = v[i];
+  _gapi_stub_record(op, 1, s.v, floats * sizeof(float), s.rgba, 4);
+  return 0;
+}
+
+typedef struct __attribute__((packed)) {
+  uint32_t count;
+  float thickness;
+  uint8_t rgba[4];
+} _gapiStubBatch;
+
+#ifndef GAPI_STUB_NO_BATCH
+static int32_t _gapi_stub_batch(gapiStubOp op, const float *v, int floats,
+                                uint32_t count, double thickness, uint8_t r,
+                                uint8_t g, uint8_t b, uint8_t a) {
+  _gapiStubBatch head = {count, thickness, {r, g, b, a}};
+  _gapi_stub_record(op, count, &head, sizeof(head), v,
+                    (size_t)count * floats * sizeof(float));
+  return 0;
+}
+#endif
+
+void gapi_set_title(const char *title) { (void)title; }
+
+void gapi_resize(const int32_t width, const int32_t height) {
+  gapi_stub.width = width;
+  gapi_stub.height = height;
+}
+
+void gapi_set_bg_color(const uint8_t r, const uint8_t g, const uint8_t b,
+                       const uint8_t a) {
+  (void)r;
+  (void)g;
+  (void)b;
+  (void)a;
+}
+
+void gapi_fullscreen(const int32_t fullscreen) { (void)fullscreen; }
+
+void gapi_log(const char *message) { fprintf(stderr, "%s\n", message); }
+
+int32_t gapi_init(const int32_t width, const int32_t height,
+                  const char *title) {
+  (void)title;
+  // a size from gapi_stub_window() wins
+  if (gapi_stub.width == 0 || gapi_stub.height == 0)
+    gapi_stub_window(width, height);
+  clock_gettime(CLOCK_MONOTONIC, &gapi_stub.start);
+  return 0;
+}
+
+static void _gapi_stub_key(char t, char k, int down) {
+  int i = 0;
+  while (i < gapi_stub.keys_n &&
+         (gapi_stub.keys[i][0] != t || gapi_stub.keys[i][1] != k))
+    i++;
+  if (down && i == gapi_stub.keys_n && i < GAPI_STUB_KEYS) {
+    gapi_stub.keys[i][0] = t;
+    gapi_stub.keys[i][1] = k;
+    gapi_stub.keys_n++;
+  } else if (!down && i < gapi_stub.keys_n) {
+    gapi_stub.keys_n--;
+    memcpy(gapi_stub.keys[i], gapi_stub.keys[gapi_stub.keys_n], 2);
+  }
+}
+
+static void _gapi_stub_replay(long frame) {
+  while (gapi_stub.event < gapi_stub.events_n &&
+         gapi_stub.events[gapi_stub.event].frame <= frame) {
+    const _gapiStubEvent *e = &gapi_stub.events[gapi_stub.event++];
+    switch (e->kind) {
+    case _GAPI_STUB_MOUSE:
+      gapi_stub.mouse_x = e->x;
+      gapi_stub.mouse_y = e->y;
+      break;
+    case _GAPI_STUB_DOWN:
+    case _GAPI_STUB_UP:
+      gapi_stub.mouse_down = e->kind == _GAPI_STUB_DOWN;
+      break;
+    case _GAPI_STUB_KEY:
+    case _GAPI_STUB_RELEASE:
+      _gapi_stub_key(e->t, e->k, e->kind == _GAPI_STUB_KEY);
+      break;
+    case _GAPI_STUB_RESIZE:
+      gapi_resize(e->x, e->y);
+      break;
+    case _GAPI_STUB_QUIT:
+      gapi_stub.quit = 1;
+      break;
+    }
+  }
+}
+
+int32_t gapi_yield(double *dt) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  long done = gapi_stub.frames; // frames whose loop() just returned
+  if (done == 0) {
+    gapi_stub.setup_ms = _gapi_stub_ms(gapi_stub.start, now);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &gapi_stub.cpu_start);
+  } else if (done <= GAPI_STUB_MAX_FRAMES)
+    gapi_stub.times[done - 1] = _gapi_stub_ms(gapi_stub.frame_start, now);
+  if (gapi_stub.overflowed)
+    gapi_stub.overflows++;
+  *dt = 1.0 / 60;
+  _gapi_stub_replay(done);
+  if (gapi_stub.quit || done >= gapi_stub.max_frames) {
+    struct timespec cpu;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+    gapi_stub.cpu_ms = _gapi_stub_ms(gapi_stub.cpu_start, cpu);
+    gapi_stub.quit = 1;
+    return 0;
+  }
+  // the log keeps the frame about to run, its loop() not timed yet
+  gapi_stub.log_size = 0;
+  gapi_stub.overflowed = 0;
+  gapi_stub.frames++;
+  clock_gettime(CLOCK_MONOTONIC, &gapi_stub.frame_start);
+  return 1;
+}
+
+void gapi_quit() { gapi_stub.quit = 1; }
+
+int32_t gapi_runs() { return !gapi_stub.quit; }
+
+int32_t gapi_draw_line(double x1, double y1, double x2, double y2,
+                       double thickness, uint8_t r, uint8_t g, uint8_t b,
+                       uint8_t a) {
+  double v[] = {x1, y1, x2, y2, thickness};
+  return _gapi_stub_shape(GAPI_STUB_LINE, 5, v, r, g, b, a);
+}
+
+int32_t gapi_draw_rect(double x, double y, double w, double h, uint8_t cr,
+                       uint8_t cg, uint8_t cb, uint8_t ca) {
+  double v[] = {x, y, w, h};
+  return _gapi_stub_shape(GAPI_STUB_RECT, 4, v, cr, cg, cb, ca);
+}
+
+int32_t gapi_draw_rounded_rect(double x, double y, double w, double h,
+                               double r, uint8_t cr, uint8_t cg, uint8_t cb,
+                               uint8_t ca) {
+  double v[] = {x, y, w, h, r};
+  return _gapi_stub_shape(GAPI_STUB_ROUNDED_RECT, 5, v, cr, cg, cb, ca);
+}
+
+int32_t gapi_draw_circle(double center_x, double center_y, double radius,
+                         uint8_t red, uint8_t green, uint8_t blue,
+                         uint8_t alpha) {
+  double v[] = {center_x, center_y, radius};
+  return _gapi_stub_shape(GAPI_STUB_CIRCLE, 3, v, red, green, blue, alpha);
+}
+
+int32_t gapi_draw_ellipse(double x, double y, double w, double h, uint8_t cr,
+                          uint8_t cg, uint8_t cb, uint8_t ca) {
+  double v[] = {x, y, w, h};
+  return _gapi_stub_shape(GAPI_STUB_ELLIPSE, 4, v, cr, cg, cb, ca);
+}
+
+int32_t gapi_draw_triangle(double x1, double y1, double x2, double y2,
+                           double x3, double y3, uint8_t cr, uint8_t cg,
+                           uint8_t cb, uint8_t ca) {
+  double v[] = {x1, y1, x2, y2, x3, y3};
+  return _gapi_stub_shape(GAPI_STUB_TRIANGLE, 6, v, cr, cg, cb, ca);
+}
+
+#ifndef GAPI_STUB_NO_BATCH
+int32_t gapi_draw_lines(const float *xy, uint32_t count, double thickness,
+                        uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+  return _gapi_stub_batch(GAPI_STUB_LINES, xy, 4, count, thickness, r, g, b,
+                          a);
+}
+
+int32_t gapi_draw_circles(const float *xyr, uint32_t count, uint8_t r,
+                          uint8_t g, uint8_t b, uint8_t a) {
+  return _gapi_stub_batch(GAPI_STUB_CIRCLES, xyr, 3, count, 0, r, g, b, a);
+}
+
+int32_t gapi_draw_rects(const float *xywh, uint32_t count, uint8_t r,
+                        uint8_t g, uint8_t b, uint8_t a) {
+  return _gapi_stub_batch(GAPI_STUB_RECTS, xywh, 4, count, 0, r, g, b, a);
+}
+#endif
+
+// files are not read, every image is a blank square of this side
+#define GAPI_STUB_IMAGE_SIDE 64
+
+uint32_t gapi_create_image(const char *path, uint32_t *width,
+                           uint32_t *height) {
+  (void)path;
+  *width = *height = GAPI_STUB_IMAGE_SIDE;
+  return ++gapi_stub.handles;
+}
+
+typedef struct __attribute__((packed)) {
+  uint32_t handle;
+  float v[4];
+} _gapiStubImage;
+
+int32_t gapi_draw_image(uint32_t handle, double x, double y, double width,
+                        double height) {
+  _gapiStubImage args = {handle, {x, y, width, height}};
+  _gapi_stub_record(GAPI_STUB_IMAGE, 1, &args, sizeof(args), NULL, 0);
+  return 0;
+}
+
+int32_t gapi_draw_image_part(uint32_t handle, uint32_t slice_x,
+                             uint32_t slice_y, uint32_t slice_width,
+                             uint32_t slice_height, double x, double y,
+                             double width, double height) {
+  uint32_t slice[] = {slice_x, slice_y, slice_width, slice_height};
+  _gapiStubImage args = {handle, {x, y, width, height}};
+  _gapi_stub_record(GAPI_STUB_IMAGE_PART, 1, &args, sizeof(args), slice,
+                    sizeof(slice));
+  return 0;
+}
+
+uint32_t gapi_create_image_rgba(const uint8_t *pixels, uint32_t width,
+                                uint32_t height) {
+  (void)pixels;
+  (void)width;
+  (void)height;
+  return ++gapi_stub.handles;
+}
+
+int32_t gapi_update_image_rgba(uint32_t handle, const uint8_t *pixels,
+                               uint32_t width, uint32_t height) {
+  (void)pixels;
+  (void)width;
+  (void)height;
+  return handle != 0 && handle <= gapi_stub.handles ? 0 : -1;
+}
+
+#ifndef GAPI_STUB_NO_LAYERS
+uint32_t gapi_create_layer() { return ++gapi_stub.handles; }
+
+int32_t gapi_begin_layer(uint32_t handle, double x, double y, double width,
+                         double height) {
+  if (gapi_stub.layer)
+    return -1;
+  gapi_stub.layer = 1;
+  _gapiStubImage args = {handle, {x, y, width, height}};
+  _gapi_stub_record(GAPI_STUB_BEGIN_LAYER, 0, &args, sizeof(args), NULL, 0);
+  return 0;
+}
+
+int32_t gapi_end_layer() {
+  if (!gapi_stub.layer)
+    return -1;
+  gapi_stub.layer = 0;
+  _gapi_stub_record(GAPI_STUB_END_LAYER, 0, NULL, 0, NULL, 0);
+  return 0;
+}
+#endif
+
+int32_t gapi_window_size(int32_t *width, int32_t *height) {
+  *width = gapi_stub.width;
+  *height = gapi_stub.height;
+  return 0;
+}
+
+typedef struct __attribute__((packed)) {
+  float x, y, height;
+  uint8_t style, rgba[4];
+  uint16_t length;
+} _gapiStubText;
+
+int32_t gapi_draw_text(double x, double y, double height, const char *txt,
+                       const char *font, uint8_t style, uint8_t cr,
+                       uint8_t cg, uint8_t cb, uint8_t ca) {
+  (void)font;
+  size_t length = strlen(txt);
+  if (length > UINT16_MAX)
+    length = UINT16_MAX;
+  _gapiStubText args = {x, y, height, style, {cr, cg, cb, ca}, length};
+  _gapi_stub_record(GAPI_STUB_TEXT, 1, &args, sizeof(args), txt, length);
+  return 0;
+}
+
+#ifndef GAPI_STUB_NO_TEXT_RUNS
+uint32_t gapi_create_text_run(double height, const char *txt,
+                              const char *font, uint8_t style) {
+  (void)height;
+  (void)txt;
+  (void)font;
+  (void)style;
+  gapi_stub.text_runs++;
+  return ++gapi_stub.handles;
+}
+
+typedef struct __attribute__((packed)) {
+  uint32_t run;
+  float x, y;
+  uint8_t rgba[4];
+} _gapiStubTextRun;
+
+int32_t gapi_draw_text_run(uint32_t run, double x, double y, uint8_t cr,
+                           uint8_t cg, uint8_t cb, uint8_t ca) {
+  _gapiStubTextRun args = {run, x, y, {cr, cg, cb, ca}};
+  _gapi_stub_record(GAPI_STUB_TEXT_RUN, 1, &args, sizeof(args), NULL, 0);
+  return 0;
+}
+
+void gapi_free_text_run(uint32_t run) {
+  (void)run;
+  gapi_stub.text_runs--;
+}
+#endif
+
+int32_t gapi_key_down(char t, char k) {
+  for (int i = 0; i < gapi_stub.keys_n; i++)
+    if (gapi_stub.keys[i][0] == t && gapi_stub.keys[i][1] == k)
+      return 1;
+  return 0;
+}
+
+void gapi_wait_queue() {}
+
+int32_t gapi_mouse_down() { return gapi_stub.mouse_down; }
+
+int32_t gapi_mouse_get(double *x, double *y) {
+  *x = gapi_stub.mouse_x;
+  *y = gapi_stub.mouse_y;
+  return 0;
+}
@@ -53,3 +53,37 @@ void gm_image_draw_part(gmImage i, int slice_x, int slice_y, int slice_width,
   gapi_draw_image_part(i.handle, slice_x, slice_y, slice_width, slice_height, x,
                        y, w, h);
 }
+
+/**
+ * @brief Creates an image from raw pixels, for images computed at runtime.
+ * @param pixels RGBA8 pixels, width * height * 4 bytes, rows from the top.
+ *               The backend keeps its own copy.
+ * @param width The width of the image in pixels.
+ * @param height The height of the image in pixels.
+ * @return The image, with a width and height of 0 when the backend cannot
+ *         create images from pixels.
+ */
+gmImage gm_image_from_pixels(const uint8_t *pixels, uint32_t width,
+                             uint32_t height) {
+  gmImage img = {0, 0, 0};
+  if (!gapi_has(gapi_create_image_rgba))
+    return img;
+  img.handle = gapi_create_image_rgba(pixels, width, height);
+  if (img.handle != 0) {
+    img.width = width;
+    img.height = height;
+  }
+  return img;
+}
+
+/**
+ * @brief Replaces the pixels of an image made by gm_image_from_pixels().
+ * @param i The image to update.
+ * @param pixels RGBA8 pixels of the image's size, rows from the top.
+ * @return 0 on success, -1 when the image or the backend does not support it.
+ */
+int32_t gm_image_set_pixels(gmImage i, const uint8_t *pixels) {
+  if (i.width == 0 || !gapi_has(gapi_update_image_rgba))
+    return -1;
+  return gapi_update_image_rgba(i.handle, pixels, i.width, i.height);
+}
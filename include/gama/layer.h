@@ -0,0 +1,118 @@
+/**
+ * @file layer.h
+ * @brief Offscreen layers for content that rarely changes.
+ *
+ * A layer covers a rectangle of the world. Its content is drawn once into an
+ * offscreen image, then each frame costs a single image draw until the layer
+ * is invalidated, or the camera or the window size changes. Backends without
+ * layers draw the content directly every frame, so the same code works
+ * everywhere:
+ *
+ * @code
+ * if (gm_layer_begin(&layer)) {
+ *   draw_static_things();
+ *   gm_layer_end(&layer);
+ * }
+ * gm_layer_draw(&layer);
+ * @endcode
+ */
+
+#pragma once
+
+#include "camera.h"
+#include "gapi.h"
+#include <stdint.h>
+
+/**
+ * @brief An offscreen layer and the world rectangle it covers.
+ */
+typedef struct {
+  uint32_t handle;      /**< Backend image handle, 0 until first drawn */
+  double x, y;          /**< Center of the covered rectangle */
+  double width, height; /**< Size of the covered rectangle */
+  int32_t window_width, window_height; /**< Window size it was drawn at */
+  gmCamera camera;                     /**< Camera it was drawn through */
+  int valid;     /**< The content is up to date */
+  int recording; /**< Between gm_layer_begin() and gm_layer_end() */
+} gmLayer;
+
+/**
+ * @brief Creates a layer over a rectangle of the world.
+ * @param x The x-coordinate of the center of the rectangle.
+ * @param y The y-coordinate of the center of the rectangle.
+ * @param width The width of the rectangle.
+ * @param height The height of the rectangle.
+ * @return The layer, empty until first drawn.
+ */
+gmLayer gm_layer(double x, double y, double width, double height) {
+  return (gmLayer){.x = x, .y = y, .width = width, .height = height};
+}
+
+/**
+ * @brief Marks the content of a layer as out of date.
+ * @param l The layer.
+ */
+void gm_layer_invalidate(gmLayer *l) { l->valid = 0; }
+
+/**
+ * @brief Starts redrawing a layer, if it needs it.
+ *
+ * When this returns 1, the caller draws the content and then calls
+ * gm_layer_end(). Without backend support the content goes straight to the
+ * screen and this returns 1 every frame.
+ *
+ * @param l The layer.
+ * @return 1 when the content must be drawn, 0 when the layer is up to date.
+ */
+int gm_layer_begin(gmLayer *l) {
+  if (!gapi_has(gapi_create_layer))
+    return 1;
+  int32_t width = 0, height = 0;
+  if (gapi_has(gapi_window_size))
+    gapi_window_size(&width, &height);
+  if (l->valid && width == l->window_width && height == l->window_height &&
+      l->camera.x == gm_camera.x && l->camera.y == gm_camera.y &&
+      l->camera.zoom == gm_camera.zoom)
+    return 0;
+  l->valid = 0;
+  if (l->handle == 0)
+    l->handle = gapi_create_layer();
+  if (l->handle == 0 ||
+      gapi_begin_layer(l->handle, gm_camera_x(l->x), gm_camera_y(l->y),
+                       gm_camera_length(l->width),
+                       gm_camera_length(l->height)) != 0)
+    return 1;
+  l->window_width = width;
+  l->window_height = height;
+  l->camera = gm_camera;
+  l->recording = 1;
+  return 1;
+}
+
+/**
+ * @brief Ends a redraw started by gm_layer_begin().
+ * @param l The layer.
+ */
+void gm_layer_end(gmLayer *l) {
+  if (!l->recording)
+    return;
+  gapi_end_layer();
+  l->recording = 0;
+  l->valid = 1;
+}
+
+/**
+ * @brief Draws the content of a layer over its rectangle.
+ *
+ * Does nothing when the content was drawn directly instead.
+ *
+ * @param l The layer.
+ * @return An identifier for the drawing command, or -1.
+ */
+int32_t gm_layer_draw(const gmLayer *l) {
+  if (!l->valid)
+    return -1;
+  return gapi_draw_image(l->handle, gm_camera_x(l->x), gm_camera_y(l->y),
+                         gm_camera_length(l->width),
+                         gm_camera_length(l->height));
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+// Near-duplicate compaction: points in the same tolerance-sized square cell
+// become one point at their weighted centroid, weighing as much as all of
+// them. Sensor data repeats itself, and every epoch and loss scan costs per
+// stored point, not per sample.
+//
+// One pass over the points with an open addressing table from cell to the
+// point it merges into. Points merge into slots at or before their own
+// index, so the columns are rewritten in place, in first-seen order. The
+// representative of a cell keeps its id, the ids merged into it are gone.
+
+#include "point_grid.h"
+#include "user_points.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+// a cell, both coordinates in full: packing them in one word would merge
+// cells that far apart
+typedef struct {
+  int64_t x, y;
+} _compact_cell;
+
+static inline size_t _compact_slot(_compact_cell c, size_t mask) {
+  uint64_t h = ((uint64_t)c.x * 0x9E3779B97F4A7C15ull) ^
+               ((uint64_t)c.y * 0xC2B2AE3D27D4EB4Full);
+  return (h ^ h >> 29) & mask;
+}
+
+// merges the points of s within `tolerance` cells, returns how many points
+// were merged away, or -1 when out of memory with s untouched
+long points_compact(point_store *s, double tolerance) {
+  if (s->n < 2 || !(tolerance > 0))
+    return 0;
+  size_t slots = GRID_MIN_BUCKETS;
+  while (slots < 2 * s->n)
+    slots *= 2;
+  uint32_t *table = malloc(slots * sizeof(uint32_t));
+  _compact_cell *cells = malloc(s->n * sizeof(_compact_cell));
+  if (table == NULL || cells == NULL || !_points_track_ids(s) ||
+      !points_track_weights(s)) {
+    free(table);
+    free(cells);
+    return -1;
+  }
+  for (size_t b = 0; b < slots; b++)
+    table[b] = POINT_NONE;
+  double inv_cell = 1 / tolerance;
+  size_t m = 0;
+  for (size_t i = 0; i < s->n; i++) {
+    double x = s->x[i], y = s->y[i], w = s->w[i];
+    // too far out for a cell of its own, or not finite: kept alone rather
+    // than merged with every point clamped into the same edge cell
+    int alone = !_grid_in_range(x, inv_cell) || !_grid_in_range(y, inv_cell);
+    _compact_cell cell = {_grid_coord(x, inv_cell), _grid_coord(y, inv_cell)};
+    size_t b = _compact_slot(cell, slots - 1);
+    uint32_t o = POINT_NONE;
+    if (!alone) {
+      while (table[b] != POINT_NONE &&
+             (cells[table[b]].x != cell.x || cells[table[b]].y != cell.y))
+        b = (b + 1) & (slots - 1);
+      o = table[b];
+    }
+    if (o == POINT_NONE) {
+      o = m++;
+      if (!alone) {
+        table[b] = o;
+        cells[o] = cell;
+      }
+      s->x[o] = x;
+      s->y[o] = y;
+      s->w[o] = w;
+      s->id[o] = s->id[i];
+      s->index_of[s->id[o]] = o;
+      continue;
+    }
+    // running weighted mean, no large sums to cancel
+    s->w[o] += w;
+    s->x[o] += (x - s->x[o]) * w / s->w[o];
+    s->y[o] += (y - s->y[o]) * w / s->w[o];
+    s->index_of[s->id[i]] = POINT_NONE;
+  }
+  free(table);
+  free(cells);
+  long merged = s->n - m;
+  s->n = m;
+  return merged;
+}
+
+// compacts user_points, returns the number of points merged away or -1.
+// The stats are rebuilt from the centroids, so the exact fit and the
+// trained one see the same data.
+long compact_user_points(double tolerance) {
+  long merged = points_compact(&user_points, tolerance);
+  if (merged <= 0)
+    return merged;
+  stats_reset(&user_stats);
+  for (size_t i = 0; i < user_points.n; i++)
+    stats_add_weighted(&user_stats, user_points.x[i], user_points.y[i],
+                       user_points.w[i]);
+  grid_free(&user_grid);
+  points_version++;
+  return merged;
+}
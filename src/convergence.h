@@ -0,0 +1,91 @@
+#pragma once
+
+// Suspends autoplay once the fit stops moving and resumes it when the points
+// or the training setup change, so an idle dashboard does not burn a core.
+
+#include "line.h"
+
+// Under L1 the subgradient is a mean of signs: it does not vanish at the
+// optimum, and the parameters keep hopping around it by a learning rate
+// step, so the loss only plateaus, possibly between two values. Then
+// step_tol and grad_tol are skipped, and a check passes when the loss did
+// not beat its best by more than loss_rtol.
+typedef struct {
+  double loss_rtol; // |Δloss| / loss between two checks, 0 disables
+  double step_tol;  // largest parameter change over an epoch, 0 disables
+  double grad_tol;  // norm of the mean gradient over an epoch, 0 disables
+  size_t patience;  // consecutive checks that must all pass
+} convergence_criteria;
+
+convergence_criteria convergence = {
+    .loss_rtol = 1e-9, .step_tol = 1e-9, .grad_tol = 1e-6, .patience = 30};
+
+int converged = 0;
+
+struct {
+  unsigned long version;
+  double learn_rate;
+  train_mode training;
+  optimizer_kind optimizer;
+  loss_kind loss_type;
+  int exact_fit;
+  double loss, best;
+  size_t streak;
+} _convergence = {.loss = -1, .best = -1};
+
+void reset_convergence() {
+  converged = 0;
+  _convergence.streak = 0;
+  _convergence.loss = -1;
+  _convergence.best = -1;
+}
+
+// call at the start of a frame, before the loss is used: when the points or
+// the training settings changed, convergence and the optimizer start over
+void watch_convergence() {
+  if (_convergence.version == points_version &&
+      _convergence.learn_rate == learn_rate &&
+      _convergence.training == training &&
+      _convergence.optimizer == opt.kind &&
+      _convergence.loss_type == loss_type &&
+      _convergence.exact_fit == exact_fit)
+    return;
+  _convergence.version = points_version;
+  _convergence.learn_rate = learn_rate;
+  _convergence.training = training;
+  _convergence.optimizer = opt.kind;
+  _convergence.loss_type = loss_type;
+  _convergence.exact_fit = exact_fit;
+  reset_convergence();
+  // momentum and moments were gathered on the old problem
+  optimizer_reset(&opt);
+}
+
+// call after a frame that ran epochs, with loss up to date
+void check_convergence() {
+  if (converged || exact_fit)
+    return;
+  int settled = 1;
+  if (minimized_loss() == LOSS_L1) {
+    settled = _convergence.best >= 0 &&
+              loss >= _convergence.best * (1 - convergence.loss_rtol);
+  } else {
+    if (convergence.loss_rtol > 0)
+      settled &= _convergence.loss >= 0 && fabs(loss - _convergence.loss) <=
+                                               convergence.loss_rtol * loss;
+    if (convergence.step_tol > 0)
+      settled &= epoch_step <= convergence.step_tol;
+    // an epoch of several steps pools gradients taken at different lines,
+    // which keep a bias once it settles into a cycle: mini-batch and
+    // stochastic training are judged on the net step and the loss alone
+    if (convergence.grad_tol > 0 && training == TRAIN_BATCH)
+      settled &= epoch_grads[0] * epoch_grads[0] +
+                     epoch_grads[1] * epoch_grads[1] <=
+                 convergence.grad_tol * convergence.grad_tol;
+  }
+  _convergence.loss = loss;
+  if (_convergence.best < 0 || loss < _convergence.best)
+    _convergence.best = loss;
+  _convergence.streak = settled ? _convergence.streak + 1 : 0;
+  converged = _convergence.streak >= convergence.patience;
+}
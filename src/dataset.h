@@ -0,0 +1,492 @@
+#pragma once
+
+// Loading point files into user_points.
+//
+// CSV: one "x,y" pair per line, separated by commas, semicolons or blanks;
+// lines that do not start with two numbers (headers, comments) are skipped.
+// The file is read whole and parsed in parallel; when it does not fit in
+// memory it is streamed line by line instead.
+// Binary (.bin): raw native-endian float64 x, y pairs, no header.
+// Lineup points (.lup): a points_header, then the x column and the y column,
+// each starting on a 64-byte boundary. float64 files are mapped into the
+// point store as they are; float32 files are widened on load. The header
+// carries the line_stats, which one parallel pass checks against the points
+// along with their being finite: a stale or hand-made header is refused
+// rather than trusted with the exact fit.
+
+#include "pool.h"
+#include "reduce.h"
+#include "user_points.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef POINT_STORE_MMAP
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define POINTS_MAGIC "LINEUPPT"
+#define POINTS_VERSION 1
+#define POINTS_ALIGN 64
+
+// bytes per coordinate
+typedef enum {
+  POINTS_F32 = 4,
+  POINTS_F64 = 8,
+} points_dtype;
+
+typedef struct {
+  char magic[8]; // POINTS_MAGIC, not NUL terminated
+  uint32_t version;
+  uint32_t dtype;
+  uint64_t count;
+  uint64_t x_offset, y_offset; // from the start of the file
+  line_stats stats;            // of the stored (possibly rounded) values
+} points_header;
+
+// CSV lines are parsed through a buffer this size, longer lines are cut
+#define CSV_LINE 256
+#ifndef CSV_CHUNK
+// bytes of text per parallel chunk
+#define CSV_CHUNK (1 << 20)
+#endif
+
+static int _has_extension(const char *path, const char *ext) {
+  size_t n = strlen(path), m = strlen(ext);
+  return n >= m && strcmp(path + n - m, ext) == 0;
+}
+
+// parses "x<sep>y" at the start of line, 0 if it does not hold two finite
+// numbers: strtod takes "inf" and "nan", which no line can be fitted through
+static int _csv_pair(const char *line, double *x, double *y) {
+  char *end;
+  *x = strtod(line, &end);
+  if (end == line)
+    return 0;
+  const char *next = end + strspn(end, " \t,;");
+  *y = strtod(next, &end);
+  return end != next && __builtin_isfinite(*x) && __builtin_isfinite(*y);
+}
+
+static long _load_points_csv_stream(FILE *f) {
+  char line[CSV_LINE];
+  long loaded = 0;
+  double x, y;
+  while (fgets(line, sizeof(line), f)) {
+    if (!_csv_pair(line, &x, &y))
+      continue;
+    if (!add_user_point(x, y))
+      break;
+    loaded++;
+  }
+  return loaded;
+}
+
+typedef struct {
+  const char *text;
+  size_t size;
+  size_t *first;     // per chunk, where its points go in x and y
+  size_t *parsed;    // per chunk, how many it found
+  line_stats *stats; // per chunk
+  double *x, *y;
+} _csv_job;
+
+// upper bound of the points in a chunk: the lines starting in it
+static void _csv_count_chunk(size_t c, void *ctx) {
+  _csv_job *job = ctx;
+  size_t start = c * CSV_CHUNK;
+  size_t end = start + CSV_CHUNK < job->size ? start + CSV_CHUNK : job->size;
+  size_t lines = 1;
+  for (const char *p = job->text + start;
+       (p = memchr(p, '\n', job->text + end - p)) != NULL; p++)
+    lines++;
+  job->parsed[c] = lines;
+}
+
+// a chunk owns the lines that start inside it
+static void _csv_parse_chunk(size_t c, void *ctx) {
+  _csv_job *job = ctx;
+  size_t start = c * CSV_CHUNK;
+  size_t end = start + CSV_CHUNK < job->size ? start + CSV_CHUNK : job->size;
+  const char *p = job->text + start, *stop = job->text + end;
+  const char *text_end = job->text + job->size;
+  if (start > 0 && p[-1] != '\n') {
+    p = memchr(p, '\n', text_end - p);
+    p = p ? p + 1 : text_end;
+  }
+  double *x = job->x + job->first[c], *y = job->y + job->first[c];
+  size_t k = 0;
+  line_stats stats = {0};
+  char line[CSV_LINE];
+  while (p < stop) {
+    const char *eol = memchr(p, '\n', text_end - p);
+    if (eol == NULL)
+      eol = text_end;
+    size_t len = eol - p < CSV_LINE - 1 ? eol - p : CSV_LINE - 1;
+    memcpy(line, p, len);
+    line[len] = 0;
+    if (_csv_pair(line, &x[k], &y[k])) {
+      stats_add(&stats, x[k], y[k]);
+      k++;
+    }
+    p = eol + 1;
+  }
+  job->parsed[c] = k;
+  job->stats[c] = stats;
+}
+
+// reads the file whole, NULL when it does not fit in memory
+static char *_read_text(FILE *f, size_t *size) {
+  if (fseek(f, 0, SEEK_END) != 0)
+    return NULL;
+  long length = ftell(f);
+  if (length < 0 || fseek(f, 0, SEEK_SET) != 0)
+    return NULL;
+  char *text = malloc(length + 1);
+  if (text == NULL)
+    return NULL;
+  *size = fread(text, 1, length, f);
+  text[*size] = 0;
+  return text;
+}
+
+static long _load_points_csv_parallel(char *text, size_t size) {
+  size_t chunks = (size + CSV_CHUNK - 1) / CSV_CHUNK;
+  _csv_job job = {.text = text, .size = size};
+  job.first = malloc(chunks * sizeof(size_t));
+  job.parsed = malloc(chunks * sizeof(size_t));
+  job.stats = malloc(chunks * sizeof(line_stats));
+  long loaded = -1;
+  if (job.first && job.parsed && job.stats) {
+    pool_run(chunks, _csv_count_chunk, &job);
+    size_t bound = 0;
+    for (size_t c = 0; c < chunks; c++) {
+      job.first[c] = bound;
+      bound += job.parsed[c];
+    }
+    if (points_reserve(&user_points, user_points.n + bound)) {
+      job.x = user_points.x + user_points.n;
+      job.y = user_points.y + user_points.n;
+      pool_run(chunks, _csv_parse_chunk, &job);
+      // close the gaps left by lines that were not points
+      size_t k = 0;
+      for (size_t c = 0; c < chunks; c++) {
+        memmove(job.x + k, job.x + job.first[c],
+                job.parsed[c] * sizeof(double));
+        memmove(job.y + k, job.y + job.first[c],
+                job.parsed[c] * sizeof(double));
+        k += job.parsed[c];
+      }
+      if (points_commit(&user_points, k)) {
+        for (size_t c = 0; c < chunks; c++)
+          stats_merge(&user_stats, &job.stats[c]);
+        loaded = k;
+      }
+    }
+  }
+  free(job.first);
+  free(job.parsed);
+  free(job.stats);
+  return loaded;
+}
+
+long load_points_csv(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL)
+    return -1;
+  size_t size = 0;
+  char *text = _read_text(f, &size);
+  long loaded = -1;
+  if (text != NULL && size > 0) {
+    loaded = _load_points_csv_parallel(text, size);
+    if (loaded > 0) {
+      grid_free(&user_grid);
+      points_version++;
+    }
+  }
+  free(text);
+  if (loaded < 0) {
+    fseek(f, 0, SEEK_SET);
+    loaded = _load_points_csv_stream(f);
+  }
+  fclose(f);
+  return loaded;
+}
+
+long load_points_raw(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return -1;
+  // the size is known up front, grow once instead of doubling
+  if (fseek(f, 0, SEEK_END) == 0) {
+    long size = ftell(f);
+    if (size > 0)
+      points_reserve(&user_points, user_points.n + size / (2 * sizeof(double)));
+    fseek(f, 0, SEEK_SET);
+  }
+  double pairs[2 * 4096];
+  size_t read;
+  long loaded = 0;
+  while ((read = fread(pairs, 2 * sizeof(double), 4096, f)) > 0) {
+    for (size_t i = 0; i < read; i++) {
+      // as in CSV, pairs that are not finite are skipped
+      if (!__builtin_isfinite(pairs[2 * i]) ||
+          !__builtin_isfinite(pairs[2 * i + 1]))
+        continue;
+      if (!add_user_point(pairs[2 * i], pairs[2 * i + 1])) {
+        fclose(f);
+        return loaded;
+      }
+      loaded++;
+    }
+  }
+  fclose(f);
+  return loaded;
+}
+
+static inline int _column_valid(uint64_t offset, uint64_t column,
+                                size_t file_size) {
+  return offset >= sizeof(points_header) && offset <= file_size &&
+         column <= file_size - offset;
+}
+
+static int _header_valid(const points_header *h, size_t file_size) {
+  if (memcmp(h->magic, POINTS_MAGIC, 8) != 0 || h->version != POINTS_VERSION)
+    return 0;
+  if (h->dtype != POINTS_F32 && h->dtype != POINTS_F64)
+    return 0;
+  if (h->x_offset % POINTS_ALIGN || h->y_offset % POINTS_ALIGN)
+    return 0;
+  // each bound is checked without a sum or product that could wrap, for
+  // crafted headers: the columns must lie after the header, in the file
+  if (h->count >= POINT_NONE || h->count > file_size / h->dtype)
+    return 0;
+  uint64_t column = h->count * h->dtype;
+  return _column_valid(h->x_offset, column, file_size) &&
+         _column_valid(h->y_offset, column, file_size);
+}
+
+typedef struct {
+  const double *x, *y;
+  size_t n;
+  line_stats *stats; // per chunk
+  int *finite;       // per chunk
+} _lup_check_job;
+
+static void _lup_check_chunk(size_t c, void *ctx) {
+  _lup_check_job *job = ctx;
+  size_t start = c * REDUCE_CHUNK;
+  size_t end = job->n - start < REDUCE_CHUNK ? job->n : start + REDUCE_CHUNK;
+  line_stats stats = {0};
+  int finite = 1;
+  for (size_t i = start; i < end; i++) {
+    finite &= __builtin_isfinite(job->x[i]) && __builtin_isfinite(job->y[i]);
+    stats_add(&stats, job->x[i], job->y[i]);
+  }
+  job->stats[c] = stats;
+  job->finite[c] = finite;
+}
+
+static inline int _stats_near(double a, double b, double scale) {
+  return fabs(a - b) <= 1e-9 * scale;
+}
+
+// whether the header's statistics are those of the points, up to the
+// rounding of summing them in another order
+static int _stats_match(const line_stats *s, const line_stats *h) {
+  if (s->n != h->n)
+    return 0;
+  if (s->n == 0)
+    return 1;
+  double sx = __builtin_sqrt(s->sxx / s->n), sy = __builtin_sqrt(s->syy / s->n);
+  return _stats_near(s->mean_x, h->mean_x, fabs(s->mean_x) + sx) &&
+         _stats_near(s->mean_y, h->mean_y, fabs(s->mean_y) + sy) &&
+         _stats_near(s->sxx, h->sxx, s->sxx) &&
+         _stats_near(s->syy, h->syy, s->syy) &&
+         _stats_near(s->sxy, h->sxy, __builtin_sqrt(s->sxx * s->syy));
+}
+
+// 1 when the count points of x and y are finite and match the header stats
+static int _lup_points_valid(const double *x, const double *y,
+                             const points_header *h) {
+  size_t chunks = reduce_chunks(h->count);
+  _lup_check_job job = {.x = x, .y = y, .n = h->count};
+  job.stats = malloc((chunks > 0 ? chunks : 1) * sizeof(line_stats));
+  job.finite = malloc((chunks > 0 ? chunks : 1) * sizeof(int));
+  int valid = 0;
+  if (job.stats && job.finite) {
+    pool_run(chunks, _lup_check_chunk, &job);
+    line_stats stats = {0};
+    valid = 1;
+    for (size_t c = 0; c < chunks; c++) {
+      valid &= job.finite[c];
+      stats_merge(&stats, &job.stats[c]);
+    }
+    valid = valid && _stats_match(&stats, &h->stats);
+  }
+  free(job.stats);
+  free(job.finite);
+  return valid;
+}
+
+#ifdef POINT_STORE_MMAP
+// zero-copy path, 0 if the file cannot be mapped into the store as is, -1
+// when its points do not match its header
+static long _map_points_lup(const char *path) {
+  if (user_points.next_id != 0)
+    return 0;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return 0;
+  struct stat st;
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(points_header))
+    // private and writable: edits copy the touched pages, never the file
+    mapping = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                   0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return 0;
+  points_header *h = mapping;
+  if (!_header_valid(h, st.st_size) || h->dtype != POINTS_F64) {
+    munmap(mapping, st.st_size);
+    return 0;
+  }
+  points_header header = *h;
+  if (!_lup_points_valid((double *)((char *)mapping + header.x_offset),
+                         (double *)((char *)mapping + header.y_offset),
+                         &header)) {
+    munmap(mapping, st.st_size);
+    return -1;
+  }
+  if (!points_adopt_mapping(&user_points, mapping, st.st_size,
+                            (double *)((char *)mapping + header.x_offset),
+                            (double *)((char *)mapping + header.y_offset),
+                            header.count)) {
+    munmap(mapping, st.st_size);
+    return 0;
+  }
+  user_stats = header.stats;
+  return header.count;
+}
+#endif
+
+static int _read_column(FILE *f, uint64_t offset, uint32_t dtype, double *out,
+                        size_t count) {
+  if (fseek(f, offset, SEEK_SET) != 0)
+    return 0;
+  if (dtype == POINTS_F64)
+    return fread(out, sizeof(double), count, f) == count;
+  float block[4096];
+  for (size_t done = 0; done < count;) {
+    size_t m = count - done < 4096 ? count - done : 4096;
+    if (fread(block, sizeof(float), m, f) != m)
+      return 0;
+    for (size_t i = 0; i < m; i++)
+      out[done + i] = block[i];
+    done += m;
+  }
+  return 1;
+}
+
+long load_points_lup(const char *path) {
+  long loaded = 0;
+#ifdef POINT_STORE_MMAP
+  loaded = _map_points_lup(path);
+  if (loaded < 0)
+    return -1;
+#endif
+  if (loaded == 0) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+      return -1;
+    points_header h;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0)
+      size = ftell(f);
+    if (size < 0 || fseek(f, 0, SEEK_SET) != 0 ||
+        fread(&h, sizeof(h), 1, f) != 1 || !_header_valid(&h, size) ||
+        !points_reserve(&user_points, user_points.n + h.count) ||
+        !_read_column(f, h.x_offset, h.dtype, user_points.x + user_points.n,
+                      h.count) ||
+        !_read_column(f, h.y_offset, h.dtype, user_points.y + user_points.n,
+                      h.count) ||
+        !_lup_points_valid(user_points.x + user_points.n,
+                           user_points.y + user_points.n, &h) ||
+        !points_commit(&user_points, h.count)) {
+      fclose(f);
+      return -1;
+    }
+    fclose(f);
+    stats_merge(&user_stats, &h.stats);
+    loaded = h.count;
+  }
+  grid_free(&user_grid);
+  points_version++;
+  return loaded;
+}
+
+static int _write_padding(FILE *f, size_t to) {
+  static const char zeros[POINTS_ALIGN] = {0};
+  long at = ftell(f);
+  return at >= 0 && fwrite(zeros, 1, to - at, f) == to - at;
+}
+
+static int _write_column(FILE *f, const double *v, size_t n,
+                         points_dtype dtype) {
+  if (dtype == POINTS_F64)
+    return fwrite(v, sizeof(double), n, f) == n;
+  float block[4096];
+  for (size_t done = 0; done < n;) {
+    size_t m = n - done < 4096 ? n - done : 4096;
+    for (size_t i = 0; i < m; i++)
+      block[i] = v[done + i];
+    if (fwrite(block, sizeof(float), m, f) != m)
+      return 0;
+    done += m;
+  }
+  return 1;
+}
+
+static inline size_t _align_up(size_t v) {
+  return (v + POINTS_ALIGN - 1) / POINTS_ALIGN * POINTS_ALIGN;
+}
+
+// writes user_points as a .lup file, 0 on failure. The format has no weight
+// column, so compacted points are refused rather than saved unweighted.
+int save_points_lup(const char *path, points_dtype dtype) {
+  if (user_points.w != NULL)
+    return 0;
+  size_t n = user_points.n;
+  points_header h = {.version = POINTS_VERSION, .dtype = dtype, .count = n};
+  memcpy(h.magic, POINTS_MAGIC, 8);
+  h.x_offset = _align_up(sizeof(h));
+  h.y_offset = _align_up(h.x_offset + n * dtype);
+  // the statistics of what a reader will see, after any rounding
+  for (size_t i = 0; i < n; i++) {
+    double x = user_points.x[i], y = user_points.y[i];
+    if (dtype == POINTS_F32)
+      x = (float)x, y = (float)y;
+    stats_add(&h.stats, x, y);
+  }
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return 0;
+  int ok = fwrite(&h, sizeof(h), 1, f) == 1 && _write_padding(f, h.x_offset) &&
+           _write_column(f, user_points.x, n, dtype) &&
+           _write_padding(f, h.y_offset) &&
+           _write_column(f, user_points.y, n, dtype);
+  return fclose(f) == 0 && ok;
+}
+
+// picks the format from the extension, returns the number of points loaded
+// or -1 if the file could not be opened
+long load_points(const char *path) {
+  if (_has_extension(path, ".lup"))
+    return load_points_lup(path);
+  if (_has_extension(path, ".bin"))
+    return load_points_raw(path);
+  return load_points_csv(path);
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+// Density raster for clouds too large to draw point by point.
+//
+// Points are binned into a DENSITY_W x DENSITY_H grid over the visible
+// rectangle in parallel, then the counts are colored on a log scale and
+// drawn as one image. Binning only reruns when the points or the view
+// moved, so an idle frame costs one image draw whatever the point count.
+// Backends without pixel images get a grid DENSITY_COARSE times coarser,
+// drawn as one rectangle batch per color level: at most a thousand
+// rectangles even when the batch falls back to one call each.
+
+#include "pool.h"
+#include "user_points.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef DENSITY_W
+#define DENSITY_W 320
+#define DENSITY_H 200
+#endif
+// bins are summed in at most this many partial grids
+#define DENSITY_PARTIALS 16
+// the fallback merges DENSITY_COARSE x DENSITY_COARSE bins per rectangle
+#define DENSITY_COARSE 8
+#define DENSITY_COARSE_W (DENSITY_W / DENSITY_COARSE)
+#define DENSITY_COARSE_H (DENSITY_H / DENSITY_COARSE)
+#define DENSITY_LEVELS 8
+
+// above this many visible points plot_points() switches to the raster
+size_t density_threshold = 20000;
+
+// a world rectangle, the view the raster covers
+typedef struct {
+  double left, bottom, right, top;
+} _density_view;
+
+typedef struct {
+  const double *x, *y, *w;
+  size_t n, per_chunk;
+  _density_view view;
+  uint32_t *partials;
+} _density_job;
+
+struct {
+  int valid;
+  unsigned long version;
+  _density_view view;
+  uint32_t counts[DENSITY_W * DENSITY_H];
+  uint8_t pixels[DENSITY_W * DENSITY_H * 4];
+  uint32_t *partials;
+} _density;
+
+static void _density_chunk(size_t c, void *ctx) {
+  _density_job *job = ctx;
+  uint32_t *bins = job->partials + c * DENSITY_W * DENSITY_H;
+  memset(bins, 0, DENSITY_W * DENSITY_H * sizeof(uint32_t));
+  size_t start = c * job->per_chunk;
+  size_t end = start + job->per_chunk < job->n ? start + job->per_chunk : job->n;
+  double left = job->view.left, top = job->view.top;
+  double sx = DENSITY_W / (job->view.right - left);
+  double sy = DENSITY_H / (top - job->view.bottom);
+  for (size_t i = start; i < end; i++) {
+    // column from the left, row from the top; both are checked
+    // non-negative first, so the casts floor them
+    double cx = (job->x[i] - left) * sx, cy = (top - job->y[i]) * sy;
+    if (cx >= 0 && cx < DENSITY_W && cy >= 0 && cy < DENSITY_H)
+      bins[(size_t)cy * DENSITY_W + (size_t)cx] += job->w ? job->w[i] : 1;
+  }
+}
+
+// log2(v) to a few percent, without libm
+static inline double _density_log2(uint32_t v) {
+  int e = 31 - __builtin_clz(v);
+  return e + (double)(v - (1u << e)) / (1u << e);
+}
+
+// purple for sparse cells, through orange, to yellow for the densest
+static void _density_color(double t, uint8_t *px) {
+  static const uint8_t stops[3][3] = {{102, 51, 153}, {255, 165, 0},
+                                      {255, 255, 120}};
+  int k = t < 0.5 ? 0 : 1;
+  double f = t < 0.5 ? t * 2 : t * 2 - 1;
+  for (int i = 0; i < 3; i++)
+    px[i] = stops[k][i] + (stops[k + 1][i] - stops[k][i]) * f;
+  px[3] = 160 + 95 * t;
+}
+
+// recounts the bins and recolors the pixels, 0 when out of memory
+static int _density_update(_density_view view) {
+  if (_density.partials == NULL) {
+    _density.partials =
+        malloc(DENSITY_PARTIALS * DENSITY_W * DENSITY_H * sizeof(uint32_t));
+    if (_density.partials == NULL)
+      return 0;
+  }
+  size_t n = user_points.n;
+  size_t chunks = pool_threads < DENSITY_PARTIALS ? pool_threads
+                                                  : DENSITY_PARTIALS;
+  _density_job job = {.x = user_points.x,
+                      .y = user_points.y,
+                      .w = user_points.w,
+                      .n = n,
+                      .per_chunk = (n + chunks - 1) / chunks,
+                      .view = view,
+                      .partials = _density.partials};
+  pool_run(chunks, _density_chunk, &job);
+  uint32_t top = 0;
+  for (size_t b = 0; b < DENSITY_W * DENSITY_H; b++) {
+    uint32_t sum = 0;
+    for (size_t c = 0; c < chunks; c++)
+      sum += _density.partials[c * DENSITY_W * DENSITY_H + b];
+    _density.counts[b] = sum;
+    if (sum > top)
+      top = sum;
+  }
+  double scale = top > 1 ? 1 / _density_log2(top) : 1;
+  for (size_t b = 0; b < DENSITY_W * DENSITY_H; b++) {
+    uint8_t *px = _density.pixels + 4 * b;
+    if (_density.counts[b] == 0)
+      memset(px, 0, 4);
+    else
+      _density_color(_density_log2(_density.counts[b]) * scale, px);
+  }
+  return 1;
+}
+
+#ifndef LINEUP_HEADLESS
+
+struct {
+  gmImage image;
+  int created, supported;
+} _density_image = {.supported = 1};
+
+// the fallback's rectangles, sorted by color level
+struct {
+  float xywh[4 * DENSITY_COARSE_W * DENSITY_COARSE_H];
+  size_t start[DENSITY_LEVELS + 1]; // of each level's rectangles
+} _density_coarse;
+
+static void _density_build_coarse(_density_view view) {
+  static uint32_t sums[DENSITY_COARSE_W * DENSITY_COARSE_H];
+  static uint8_t levels[DENSITY_COARSE_W * DENSITY_COARSE_H];
+  memset(sums, 0, sizeof(sums));
+  uint32_t top = 0;
+  for (size_t row = 0; row < DENSITY_COARSE * DENSITY_COARSE_H; row++)
+    for (size_t col = 0; col < DENSITY_COARSE * DENSITY_COARSE_W; col++) {
+      uint32_t *sum = &sums[row / DENSITY_COARSE * DENSITY_COARSE_W +
+                            col / DENSITY_COARSE];
+      *sum += _density.counts[row * DENSITY_W + col];
+      if (*sum > top)
+        top = *sum;
+    }
+  double scale = top > 1 ? (DENSITY_LEVELS - 1) / _density_log2(top) : 0;
+  size_t per_level[DENSITY_LEVELS] = {0};
+  for (size_t c = 0; c < DENSITY_COARSE_W * DENSITY_COARSE_H; c++)
+    if (sums[c] > 0)
+      per_level[levels[c] = _density_log2(sums[c]) * scale + 0.5]++;
+  _density_coarse.start[0] = 0;
+  for (size_t l = 0; l < DENSITY_LEVELS; l++)
+    _density_coarse.start[l + 1] = _density_coarse.start[l] + per_level[l];
+  size_t next[DENSITY_LEVELS];
+  memcpy(next, _density_coarse.start, sizeof(next));
+  double w = (view.right - view.left) / DENSITY_COARSE_W;
+  double h = (view.top - view.bottom) / DENSITY_COARSE_H;
+  for (size_t row = 0; row < DENSITY_COARSE_H; row++)
+    for (size_t col = 0; col < DENSITY_COARSE_W; col++) {
+      size_t c = row * DENSITY_COARSE_W + col;
+      if (sums[c] == 0)
+        continue;
+      float *rect = _density_coarse.xywh + 4 * next[levels[c]]++;
+      rect[0] = view.left + (col + 0.5) * w;
+      rect[1] = view.top - (row + 0.5) * h;
+      rect[2] = w;
+      rect[3] = h;
+    }
+}
+
+static void _draw_density_coarse() {
+  for (size_t l = 0; l < DENSITY_LEVELS; l++) {
+    size_t start = _density_coarse.start[l];
+    size_t count = _density_coarse.start[l + 1] - start;
+    if (count == 0)
+      continue;
+    uint8_t px[4];
+    _density_color((double)l / (DENSITY_LEVELS - 1), px);
+    gm_draw_rects_batch(_density_coarse.xywh + 4 * start, count,
+                        gm_rgba(px[0], px[1], px[2], px[3]));
+  }
+}
+
+static inline int _density_same_view(_density_view a, _density_view b) {
+  return a.left == b.left && a.bottom == b.bottom && a.right == b.right &&
+         a.top == b.top;
+}
+
+// under view_camera()
+void plot_density() {
+  _density_view view;
+  gm_camera_bounds(&view.left, &view.bottom, &view.right, &view.top);
+  if (!_density.valid || _density.version != points_version ||
+      !_density_same_view(_density.view, view)) {
+    if (!_density_update(view))
+      return;
+    _density.valid = 1;
+    _density.version = points_version;
+    _density.view = view;
+    if (!_density_image.created && _density_image.supported) {
+      _density_image.image =
+          gm_image_from_pixels(_density.pixels, DENSITY_W, DENSITY_H);
+      _density_image.created = _density_image.image.width != 0;
+      _density_image.supported = _density_image.created;
+    } else if (_density_image.created) {
+      gm_image_set_pixels(_density_image.image, _density.pixels);
+    }
+    if (!_density_image.created)
+      _density_build_coarse(view);
+  }
+  double width = view.right - view.left, height = view.top - view.bottom;
+  if (_density_image.created) {
+    gm_draw_image(_density_image.image, view.left + width / 2,
+                  view.bottom + height / 2, width, height);
+    return;
+  }
+  _draw_density_coarse();
+}
+
+static int _density_count(size_t i, void *ctx) {
+  (void)i;
+  size_t *left = ctx;
+  return --*left > 0;
+}
+
+// whether more than density_threshold points are in view, remembered until
+// the points or the view change. The count stops at the threshold, and
+// walks the picking grid only when it is already built.
+struct {
+  int valid, dense;
+  unsigned long version;
+  _density_view view;
+} _density_lod;
+
+static int _density_dense() {
+  if (user_points.n <= density_threshold)
+    return 0;
+  _density_view view;
+  gm_camera_bounds(&view.left, &view.bottom, &view.right, &view.top);
+  if (!_density_lod.valid || _density_lod.version != points_version ||
+      !_density_same_view(_density_lod.view, view)) {
+    size_t left = density_threshold + 1;
+    grid_visit(&user_grid, &user_points, view.left, view.bottom, view.right,
+               view.top, _density_count, &left);
+    _density_lod.valid = 1;
+    _density_lod.dense = left == 0;
+    _density_lod.version = points_version;
+    _density_lod.view = view;
+  }
+  return _density_lod.dense;
+}
+
+// the visible points as circles, or as the density raster past
+// density_threshold of them; under view_camera()
+void plot_points() {
+  if (!_density_dense()) {
+    plot_user_points();
+    return;
+  }
+  plot_density();
+  long selected = selected_point();
+  if (selected >= 0)
+    gm_draw_circle(user_points.x[selected], user_points.y[selected],
+                   point_radius / view_zoom, gm_set_alpha(GM_ORANGE, 200));
+}
+
+#endif
@@ -0,0 +1,231 @@
+#pragma once
+
+// Synthetic datasets for stress tests, appended straight into user_points.
+//
+// Points are made in fixed GENERATE_CHUNK sized chunks, each with its own
+// splitmix64 stream seeded from (seed, chunk index), so a dataset depends on
+// the seed and the count only, never on pool_threads. Noise avoids libm: the
+// gama math build runs log and cos as series. Normal noise is Irwin-Hall
+// (the sum of 12 uniforms, less 6), Cauchy noise the ratio of two normals.
+
+#include "pool.h"
+#include "user_points.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef GENERATE_CHUNK
+#define GENERATE_CHUNK 65536
+#endif
+#define GENERATE_MAX_CLUSTERS 64
+
+typedef enum {
+  NOISE_NONE,
+  NOISE_UNIFORM, // in [-scale, scale]
+  NOISE_NORMAL,  // standard deviation scale
+  NOISE_CAUCHY,  // half width scale, heavy tailed
+} noise_kind;
+
+typedef struct {
+  double gradient, intercept;
+  double x_min, x_max;
+  noise_kind noise;
+  double noise_scale;
+  double outliers;      // fraction of points with y uniform around the line
+  double outlier_range; // outliers land within ± this of the line
+  size_t clusters;      // 0: x uniform, else x normal around k centers
+  double cluster_spread;
+  uint64_t seed;
+} generator;
+
+const generator default_generator = {.gradient = 0.7,
+                                     .intercept = -0.3,
+                                     .x_min = -2,
+                                     .x_max = 2,
+                                     .noise = NOISE_NORMAL,
+                                     .noise_scale = 0.1,
+                                     .outlier_range = 2,
+                                     .cluster_spread = 0.1,
+                                     .seed = 1};
+
+static inline uint64_t _splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// uniform in [0, 1)
+static inline double _gen_uniform(uint64_t *state) {
+  return (_splitmix64(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static inline double _gen_normal(uint64_t *state) {
+  double sum = 0;
+  for (int i = 0; i < 12; i++)
+    sum += _gen_uniform(state);
+  return sum - 6;
+}
+
+static inline double _gen_noise(const generator *g, uint64_t *state) {
+  switch (g->noise) {
+  case NOISE_NONE:
+    return 0;
+  case NOISE_UNIFORM:
+    return g->noise_scale * (2 * _gen_uniform(state) - 1);
+  case NOISE_NORMAL:
+    return g->noise_scale * _gen_normal(state);
+  case NOISE_CAUCHY: {
+    double d = _gen_normal(state);
+    return d == 0 ? 0 : g->noise_scale * _gen_normal(state) / d;
+  }
+  }
+  return 0;
+}
+
+typedef struct {
+  const generator *g;
+  size_t n;
+  double centers[GENERATE_MAX_CLUSTERS];
+  double *x, *y;
+  line_stats *stats; // per chunk
+} _generate_job;
+
+static void _generate_chunk(size_t c, void *ctx) {
+  _generate_job *job = ctx;
+  const generator *g = job->g;
+  size_t start = c * GENERATE_CHUNK;
+  size_t m = job->n - start < GENERATE_CHUNK ? job->n - start : GENERATE_CHUNK;
+  uint64_t state = g->seed ^ (c + 1) * 0xD1B54A32D192ED03ull;
+  double width = g->x_max - g->x_min;
+  line_stats stats = {0};
+  for (size_t i = start; i < start + m; i++) {
+    double x;
+    if (g->clusters > 0) {
+      size_t k = _splitmix64(&state) % g->clusters;
+      x = job->centers[k] + g->cluster_spread * _gen_normal(&state);
+    } else {
+      x = g->x_min + width * _gen_uniform(&state);
+    }
+    double y = g->gradient * x + g->intercept;
+    if (g->outliers > 0 && _gen_uniform(&state) < g->outliers)
+      y += g->outlier_range * (2 * _gen_uniform(&state) - 1);
+    else
+      y += _gen_noise(g, &state);
+    job->x[i] = x;
+    job->y[i] = y;
+    stats_add(&stats, x, y);
+  }
+  job->stats[c] = stats;
+}
+
+// appends n generated points, returns n or -1 when out of memory
+long generate_points(const generator *g, size_t n) {
+  size_t chunks = (n + GENERATE_CHUNK - 1) / GENERATE_CHUNK;
+  if (n == 0)
+    return 0;
+  _generate_job job = {.g = g, .n = n};
+  job.stats = malloc(chunks * sizeof(line_stats));
+  if (job.stats == NULL || !points_reserve(&user_points, user_points.n + n)) {
+    free(job.stats);
+    return -1;
+  }
+  uint64_t state = g->seed;
+  size_t clusters = g->clusters < GENERATE_MAX_CLUSTERS ? g->clusters
+                                                        : GENERATE_MAX_CLUSTERS;
+  for (size_t k = 0; k < clusters; k++)
+    job.centers[k] = g->x_min + (g->x_max - g->x_min) * _gen_uniform(&state);
+  generator clamped = *g;
+  clamped.clusters = clusters;
+  job.g = &clamped;
+  job.x = user_points.x + user_points.n;
+  job.y = user_points.y + user_points.n;
+  pool_run(chunks, _generate_chunk, &job);
+  long made = -1;
+  if (points_commit(&user_points, n)) {
+    for (size_t c = 0; c < chunks; c++)
+      stats_merge(&user_stats, &job.stats[c]);
+    grid_free(&user_grid);
+    points_version++;
+    made = n;
+  }
+  free(job.stats);
+  return made;
+}
+
+static int _parse_noise(const char *name, noise_kind *kind) {
+  static const char *names[] = {"none", "uniform", "normal", "cauchy"};
+  for (int k = 0; k <= NOISE_CAUCHY; k++)
+    if (strcmp(name, names[k]) == 0) {
+      *kind = k;
+      return 1;
+    }
+  return 0;
+}
+
+// a whole number of points or clusters, below the POINT_NONE points a store
+// can index; converting anything else to an integer is undefined
+static int _parse_count(double v, size_t *count) {
+  if (!(v >= 0 && v < POINT_NONE) || v != (size_t)v)
+    return 0;
+  *count = v;
+  return 1;
+}
+
+// Reads a spec like "n=1e8,noise=cauchy,scale=0.05,outliers=0.01,seed=7"
+// over the fields of g. Keys: n, slope, intercept, xmin, xmax, noise
+// (none, uniform, normal, cauchy), scale, outliers, range, clusters, spread,
+// seed. Returns n (default 10⁶), or -1 on a malformed spec or a count that
+// is negative, fractional or not below POINT_NONE.
+long generator_parse(generator *g, const char *spec) {
+  size_t n = 1000000;
+  char buffer[256];
+  strncpy(buffer, spec, sizeof(buffer) - 1);
+  buffer[sizeof(buffer) - 1] = 0;
+  for (char *field = buffer; field && *field;) {
+    char *next = strchr(field, ',');
+    if (next)
+      *next++ = 0;
+    char *value = strchr(field, '=');
+    if (value == NULL)
+      return -1;
+    *value++ = 0;
+    char *end;
+    double v = strtod(value, &end);
+    int number = end != value && *end == 0;
+    if (strcmp(field, "noise") == 0) {
+      if (!_parse_noise(value, &g->noise))
+        return -1;
+    } else if (!number) {
+      return -1;
+    } else if (strcmp(field, "n") == 0) {
+      if (!_parse_count(v, &n))
+        return -1;
+    } else if (strcmp(field, "slope") == 0) {
+      g->gradient = v;
+    } else if (strcmp(field, "intercept") == 0) {
+      g->intercept = v;
+    } else if (strcmp(field, "xmin") == 0) {
+      g->x_min = v;
+    } else if (strcmp(field, "xmax") == 0) {
+      g->x_max = v;
+    } else if (strcmp(field, "scale") == 0) {
+      g->noise_scale = v;
+    } else if (strcmp(field, "outliers") == 0) {
+      g->outliers = v;
+    } else if (strcmp(field, "range") == 0) {
+      g->outlier_range = v;
+    } else if (strcmp(field, "clusters") == 0) {
+      if (!_parse_count(v, &g->clusters))
+        return -1;
+    } else if (strcmp(field, "spread") == 0) {
+      g->cluster_spread = v;
+    } else if (strcmp(field, "seed") == 0) {
+      g->seed = strtoull(value, NULL, 10);
+    } else {
+      return -1;
+    }
+    field = next;
+  }
+  return n;
+}
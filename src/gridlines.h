@@ -1,31 +1,178 @@
 #include <gama.h>
 #include <stdio.h>
 
-void draw_gridlines() {
-  char label[5] = {0};
+// the grid covers only what the camera sees: its lines and labels are laid
+// out, and the labels formatted, when the camera moves; then the lines are
+// drawn as one batch per style. The spacing is a power of ten chosen from
+// the zoom, so there are between 4 and GRIDLINES_SPAN lines across.
+
+#define GRIDLINES_SPAN 40
+// lines per style, at most two spans of grid plus the axes; a view of
+// unknown shape is up to GM_ASPECT_MAX times wider and taller
+#define GRIDLINES_MAX (2 * GM_ASPECT_MAX * GRIDLINES_SPAN + 8)
+
+typedef struct {
+  float x, y;
+  char text[12];
+} _gridlines_label;
+
+struct {
+  int built;
+  gmCamera camera; // the view it was laid out for
+  double aspect;
+  double left, bottom, right, top;
+  _gridlines_label labels[GRIDLINES_MAX];
+  size_t labels_n;
+  float grid[4 * GRIDLINES_MAX];  // faint lines across the view
+  float major[4 * GRIDLINES_MAX]; // every fifth tick
+  float minor[4 * GRIDLINES_MAX]; // other ticks, and the axes
+  size_t grid_n, major_n, minor_n;
+} _gridlines;
+
+static void _gridline(float *lines, size_t *n, double x1, double y1, double x2,
+                      double y2) {
+  float *line = lines + 4 * (*n)++;
+  line[0] = x1;
+  line[1] = y1;
+  line[2] = x2;
+  line[3] = y2;
+}
+
+static void _gridlines_label_at(double x, double y, double value,
+                                int decimals) {
+  _gridlines_label *label = &_gridlines.labels[_gridlines.labels_n++];
+  label->x = x;
+  label->y = y;
+  snprintf(label->text, sizeof(label->text), "%.*lf", decimals, value);
+}
+
+// the power of ten giving at most GRIDLINES_SPAN lines over span, and the
+// decimals its labels need; without log10, GM_MATH makes it slow
+static double _gridlines_step(double span, int *decimals) {
+  double step = 1;
+  *decimals = 0;
+  while (span / step > GRIDLINES_SPAN)
+    step *= 10;
+  while (span / step <= GRIDLINES_SPAN / 10 && *decimals < 9) {
+    step /= 10;
+    ++*decimals;
+  }
+  return step;
+}
+
+static inline double _gridlines_clamp(double v, double low, double high) {
+  return v < low ? low : v > high ? high : v;
+}
+
+static void _build_gridlines() {
+  double left, bottom, right, top;
+  gm_camera_bounds(&left, &bottom, &right, &top);
+  _gridlines.camera = gm_camera;
+  _gridlines.aspect = gm_screen_aspect();
+  _gridlines.left = left;
+  _gridlines.bottom = bottom;
+  _gridlines.right = right;
+  _gridlines.top = top;
+  _gridlines.grid_n = _gridlines.major_n = _gridlines.minor_n = 0;
+  _gridlines.labels_n = 0;
+
+  // the spacing follows the window's longer side, not the view, which is
+  // larger when the window size is unknown
+  int decimals;
+  double unit = 1 / gm_camera.zoom, aspect = _gridlines.aspect;
+  double step = _gridlines_step(2 * unit * (aspect > 1 ? aspect : 1 / aspect),
+                                &decimals);
+  // ticks and labels keep their size on screen, and stay in view along an
+  // edge when an axis is not; without the window size, along the edge of
+  // the square every window shows
+  double edge_left = left, edge_bottom = bottom, edge_right = right,
+         edge_top = top;
+  if (gm_window_aspect() == 0) {
+    edge_left = gm_camera.x - unit;
+    edge_right = gm_camera.x + unit;
+    edge_bottom = gm_camera.y - unit;
+    edge_top = gm_camera.y + unit;
+  }
+  double axis_y = _gridlines_clamp(0, edge_bottom + 0.12 * unit, edge_top);
+  double axis_x = _gridlines_clamp(0, edge_left + 0.2 * unit, edge_right);
+  if (bottom <= 0 && top >= 0)
+    _gridline(_gridlines.minor, &_gridlines.minor_n, left, 0, right, 0);
+  if (left <= 0 && right >= 0)
+    _gridline(_gridlines.minor, &_gridlines.minor_n, 0, bottom, 0, top);
+
+  long first = (long)(left / step) - 1, last = (long)(right / step) + 1;
+  for (long i = first; i <= last; i++) {
+    double x = i * step;
+    if (x < left || x > right)
+      continue;
+    _gridline(_gridlines.grid, &_gridlines.grid_n, x, bottom, x, top);
+    int major = i % 5 == 0;
+    if (major)
+      _gridline(_gridlines.major, &_gridlines.major_n, x, axis_y, x,
+                axis_y - 0.04 * unit);
+    else
+      _gridline(_gridlines.minor, &_gridlines.minor_n, x, axis_y, x,
+                axis_y - 0.02 * unit);
+    _gridlines_label_at(x, axis_y - (major ? 0.09 : 0.07) * unit, x,
+                        decimals);
+  }
+  first = (long)(bottom / step) - 1, last = (long)(top / step) + 1;
+  for (long i = first; i <= last; i++) {
+    double y = i * step;
+    if (y < bottom || y > top)
+      continue;
+    _gridline(_gridlines.grid, &_gridlines.grid_n, left, y, right, y);
+    int major = i % 5 == 0;
+    if (major)
+      _gridline(_gridlines.major, &_gridlines.major_n, axis_x, y,
+                axis_x - 0.04 * unit, y);
+    else
+      _gridline(_gridlines.minor, &_gridlines.minor_n, axis_x, y,
+                axis_x - 0.02 * unit, y);
+    _gridlines_label_at(axis_x - (major ? 0.09 : 0.07) * unit, y, y,
+                        decimals);
+  }
+  _gridlines.built = 1;
+}
+
+static int _gridlines_current() {
+  return _gridlines.built && _gridlines.camera.x == gm_camera.x &&
+         _gridlines.camera.y == gm_camera.y &&
+         _gridlines.camera.zoom == gm_camera.zoom &&
+         _gridlines.aspect == gm_screen_aspect();
+}
+
+// everything below, labels included, is drawn once into a layer over the
+// view and blitted after that, until the camera or the window size changes
+gmLayer gridlines_layer;
+
+static void _draw_gridlines() {
   gmColor transparent_white = 0xFFFFFF99;
   gmColor more_transparent_white = 0xAAAAAA44;
-  // x axis
-  gm_draw_line(-2, 0, 2, 0, 0.005, transparent_white);
-  for (double x = -2; x <= 2; x += 0.1) {
-    gm_draw_line(x, -2, x, 2, 0.01, more_transparent_white);
-    // draw indicator line
-    int ishalf = (int)(x * 10) % 5 == 0;
-    sprintf(label, "%.1lf", x);
-    gm_draw_line(x, 0, x, ishalf ? -0.04 : -0.02, ishalf ? 0.01 : 0.005,
-                 transparent_white);
-    gm_draw_text(x, ishalf ? -0.09 : -0.07, label, "", 0.05, transparent_white);
+  gm_draw_lines_batch(_gridlines.grid, _gridlines.grid_n, 0.01,
+                      more_transparent_white);
+  gm_draw_lines_batch(_gridlines.minor, _gridlines.minor_n, 0.005,
+                      transparent_white);
+  gm_draw_lines_batch(_gridlines.major, _gridlines.major_n, 0.01,
+                      transparent_white);
+  for (size_t i = 0; i < _gridlines.labels_n; i++) {
+    const _gridlines_label *label = &_gridlines.labels[i];
+    gm_draw_text(label->x, label->y, label->text, "", 0.05, transparent_white);
+  }
+}
+
+// under the camera of the view
+void draw_gridlines() {
+  if (!_gridlines_current()) {
+    _build_gridlines();
+    gridlines_layer.x = (_gridlines.left + _gridlines.right) / 2;
+    gridlines_layer.y = (_gridlines.bottom + _gridlines.top) / 2;
+    gridlines_layer.width = _gridlines.right - _gridlines.left;
+    gridlines_layer.height = _gridlines.top - _gridlines.bottom;
   }
-  // y axis
-  gm_draw_line(0, -5, 0, 5, 0.005, transparent_white);
-
-  for (double y = -5; y <= 5; y += 0.1) {
-    gm_draw_line(-5, y, 5, y, 0.01, more_transparent_white);
-    // draw indicator line
-    int ishalf = (int)(y * 10) % 5 == 0;
-    sprintf(label, "%.1lf", y);
-    gm_draw_line(0, y, ishalf ? -0.04 : -0.02, y, ishalf ? 0.01 : 0.005,
-                 transparent_white);
-    gm_draw_text(ishalf ? -0.09 : -0.07, y, label, "", 0.05, transparent_white);
+  if (gm_layer_begin(&gridlines_layer)) {
+    _draw_gridlines();
+    gm_layer_end(&gridlines_layer);
   }
+  gm_layer_draw(&gridlines_layer);
 }
@@ -0,0 +1,188 @@
+#pragma once
+
+// Undo and redo for point edits.
+//
+// Every add, drag, delete and pan appends a small delta record naming the
+// point by its stable id, never a snapshot, so undo and redo cost O(1) each
+// whatever the point count. They replay through the same edit functions as
+// the mouse, keeping user_stats and the picking grid updated incrementally.
+//
+// Records stay open until journal_seal(), which the UI calls as each new
+// gesture starts: until then a drag of the same point, or consecutive pans,
+// update the last record instead of appending, so a whole drag undoes at once.
+
+#include "user_points.h"
+#include "utils.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define JOURNAL_MIN_CAPACITY 64
+
+typedef enum {
+  EDIT_ADD,
+  EDIT_MOVE,
+  EDIT_DELETE,
+  EDIT_PAN,
+} edit_kind;
+
+typedef struct {
+  edit_kind kind;
+  uint32_t id;
+  union {
+    struct {
+      double x, y, w;
+    } point; // add, delete
+    struct {
+      double from_x, from_y, to_x, to_y;
+    } move;
+    gmPos pan;
+  };
+} edit_record;
+
+struct {
+  edit_record *records;
+  size_t n;     // records before the cursor are done, the rest undone
+  size_t count; // records kept, those past n can be redone
+  size_t capacity;
+  int open; // the last record may still absorb the current gesture
+} journal = {0};
+
+void journal_clear() {
+  free(journal.records);
+  journal.records = NULL;
+  journal.n = journal.count = journal.capacity = 0;
+  journal.open = 0;
+}
+
+void journal_seal() { journal.open = 0; }
+
+// the open record of this kind, or NULL
+static edit_record *_journal_open(edit_kind kind) {
+  if (!journal.open || journal.n == 0 || journal.n != journal.count)
+    return NULL;
+  edit_record *last = &journal.records[journal.n - 1];
+  return last->kind == kind ? last : NULL;
+}
+
+// appends r, dropping anything that could still be redone. When out of
+// memory the history is lost rather than left with a gap.
+static void _journal_push(edit_record r) {
+  if (journal.n == journal.capacity) {
+    size_t capacity = journal.capacity < JOURNAL_MIN_CAPACITY
+                          ? JOURNAL_MIN_CAPACITY
+                          : 2 * journal.capacity;
+    edit_record *records =
+        realloc(journal.records, capacity * sizeof(edit_record));
+    if (records == NULL) {
+      lineup_log("Can not record any more edits, history cleared");
+      journal_clear();
+      return;
+    }
+    journal.records = records;
+    journal.capacity = capacity;
+  }
+  journal.records[journal.n++] = r;
+  journal.count = journal.n;
+  journal.open = 1;
+}
+
+int journal_add_point(double x, double y) {
+  if (!add_user_point(x, y))
+    return 0;
+  uint32_t id = points_id(&user_points, user_points.n - 1);
+  _journal_push((edit_record){
+      .kind = EDIT_ADD, .id = id, .point = {x, y, 1}});
+  return 1;
+}
+
+void journal_move_point(size_t i, gmPos pos) {
+  uint32_t id = points_id(&user_points, i);
+  edit_record *open = _journal_open(EDIT_MOVE);
+  if (open == NULL || open->id != id) {
+    _journal_push((edit_record){
+        .kind = EDIT_MOVE,
+        .id = id,
+        .move = {user_points.x[i], user_points.y[i], pos.x, pos.y}});
+  } else {
+    open->move.to_x = pos.x;
+    open->move.to_y = pos.y;
+  }
+  move_user_point(i, pos);
+}
+
+void journal_delete_point(size_t i) {
+  edit_record r = {.kind = EDIT_DELETE,
+                   .id = points_id(&user_points, i),
+                   .point = {user_points.x[i], user_points.y[i],
+                             points_weight(&user_points, i)}};
+  if (delete_user_point(i))
+    _journal_push(r);
+}
+
+void journal_delete_selected() {
+  long i = selected_point();
+  if (i < 0)
+    return;
+  journal_delete_point(i);
+  unselect_point();
+}
+
+void journal_pan(gmPos pos) {
+  if (pos.x == 0 && pos.y == 0)
+    return;
+  gmPos before = view_offset;
+  move_points(pos);
+  gmPos delta = {view_offset.x - before.x, view_offset.y - before.y};
+  edit_record *open = _journal_open(EDIT_PAN);
+  if (open == NULL) {
+    _journal_push((edit_record){.kind = EDIT_PAN, .pan = delta});
+  } else {
+    open->pan.x += delta.x;
+    open->pan.y += delta.y;
+  }
+}
+
+// applies r forwards or backwards. Records naming a point that is gone, or
+// that could not come back for lack of memory, are skipped.
+static void _journal_apply(const edit_record *r, int forward) {
+  uint32_t i = points_index(&user_points, r->id);
+  switch (r->kind) {
+  case EDIT_ADD:
+  case EDIT_DELETE:
+    if (forward == (r->kind == EDIT_ADD)) {
+      if (i == POINT_NONE)
+        revive_user_point(r->id, r->point.x, r->point.y, r->point.w);
+    } else if (i != POINT_NONE) {
+      if ((long)r->id == selected_id)
+        unselect_point();
+      delete_user_point(i);
+    }
+    break;
+  case EDIT_MOVE:
+    if (i != POINT_NONE)
+      move_user_point(i, forward ? (gmPos){r->move.to_x, r->move.to_y}
+                                 : (gmPos){r->move.from_x, r->move.from_y});
+    break;
+  case EDIT_PAN:
+    view_offset.x += forward ? r->pan.x : -r->pan.x;
+    view_offset.y += forward ? r->pan.y : -r->pan.y;
+    break;
+  }
+}
+
+// both return 0 when there was nothing to undo or redo
+int undo_edit() {
+  if (journal.n == 0)
+    return 0;
+  journal.open = 0;
+  _journal_apply(&journal.records[--journal.n], 0);
+  return 1;
+}
+
+int redo_edit() {
+  if (journal.n == journal.count)
+    return 0;
+  journal.open = 0;
+  _journal_apply(&journal.records[journal.n++], 1);
+  return 1;
+}
@@ -0,0 +1,291 @@
+#pragma once
+
+// Batch reductions over the point cloud, vectorized per target:
+// AVX (4 lanes), SSE2 (2 lanes) and WASM SIMD128 (2 lanes), with a scalar
+// fallback. The ISA is picked at compile time from the usual predefined
+// macros, so build with -mavx2 / -msimd128 to get the wider paths.
+//
+// The public kernels switch on the loss and on whether there are weights
+// once, and call an always-inlined body with both constant, so each
+// combination gets its own branch-free loop.
+
+#include "loss.h"
+#include <stddef.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+#define _KERNEL static inline __attribute__((always_inline))
+
+// everything one epoch needs from a single read of the points
+// every sum is weighted by the point weights, when there are some
+typedef struct {
+  double e;    // Σ slope(error)
+  double ex;   // Σ slope(error) * x
+  double loss; // Σ loss(error)
+  double w;    // Σ weight, n without weights
+} fit_sums;
+
+_KERNEL fit_sums _fit_sums_scalar(const double *x, const double *y,
+                                  const double *w, size_t n, double a,
+                                  double b, loss_kind kind, double delta,
+                                  int weighted) {
+  fit_sums s = {0, 0, 0, weighted ? 0 : n};
+  for (size_t i = 0; i < n; i++) {
+    double error = a * x[i] + b - y[i];
+    double wi = weighted ? w[i] : 1;
+    double slope = wi * loss_slope(kind, delta, error);
+    s.e += slope;
+    s.ex += slope * x[i];
+    s.loss += wi * loss_value(kind, delta, error);
+    if (weighted)
+      s.w += wi;
+  }
+  return s;
+}
+
+#if defined(__AVX__)
+_KERNEL __m256d _slope256(__m256d e, loss_kind kind, __m256d delta) {
+  __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1);
+  switch (kind) {
+  case LOSS_L1:
+    return _mm256_sub_pd(
+        _mm256_and_pd(_mm256_cmp_pd(e, zero, _CMP_GT_OQ), one),
+        _mm256_and_pd(_mm256_cmp_pd(e, zero, _CMP_LT_OQ), one));
+  case LOSS_HUBER:
+    return _mm256_min_pd(_mm256_max_pd(e, _mm256_sub_pd(zero, delta)), delta);
+  case LOSS_L2:
+    break;
+  }
+  return e;
+}
+_KERNEL __m256d _loss256(__m256d e, loss_kind kind, __m256d delta) {
+  __m256d abs = _mm256_andnot_pd(_mm256_set1_pd(-0.0), e);
+  __m256d half = _mm256_set1_pd(0.5);
+  switch (kind) {
+  case LOSS_L1:
+    return abs;
+  case LOSS_HUBER: {
+    __m256d c = _mm256_min_pd(abs, delta);
+    return _mm256_mul_pd(c, _mm256_sub_pd(abs, _mm256_mul_pd(half, c)));
+  }
+  case LOSS_L2:
+    break;
+  }
+  return _mm256_mul_pd(half, _mm256_mul_pd(e, e));
+}
+#elif defined(__SSE2__)
+_KERNEL __m128d _slope128(__m128d e, loss_kind kind, __m128d delta) {
+  __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1);
+  switch (kind) {
+  case LOSS_L1:
+    return _mm_sub_pd(_mm_and_pd(_mm_cmpgt_pd(e, zero), one),
+                      _mm_and_pd(_mm_cmplt_pd(e, zero), one));
+  case LOSS_HUBER:
+    return _mm_min_pd(_mm_max_pd(e, _mm_sub_pd(zero, delta)), delta);
+  case LOSS_L2:
+    break;
+  }
+  return e;
+}
+_KERNEL __m128d _loss128(__m128d e, loss_kind kind, __m128d delta) {
+  __m128d abs = _mm_andnot_pd(_mm_set1_pd(-0.0), e), half = _mm_set1_pd(0.5);
+  switch (kind) {
+  case LOSS_L1:
+    return abs;
+  case LOSS_HUBER: {
+    __m128d c = _mm_min_pd(abs, delta);
+    return _mm_mul_pd(c, _mm_sub_pd(abs, _mm_mul_pd(half, c)));
+  }
+  case LOSS_L2:
+    break;
+  }
+  return _mm_mul_pd(half, _mm_mul_pd(e, e));
+}
+#elif defined(__wasm_simd128__)
+_KERNEL v128_t _slope128(v128_t e, loss_kind kind, v128_t delta) {
+  v128_t zero = wasm_f64x2_splat(0), one = wasm_f64x2_splat(1);
+  switch (kind) {
+  case LOSS_L1:
+    return wasm_f64x2_sub(wasm_v128_and(wasm_f64x2_gt(e, zero), one),
+                          wasm_v128_and(wasm_f64x2_lt(e, zero), one));
+  case LOSS_HUBER:
+    return wasm_f64x2_min(wasm_f64x2_max(e, wasm_f64x2_neg(delta)), delta);
+  case LOSS_L2:
+    break;
+  }
+  return e;
+}
+_KERNEL v128_t _loss128(v128_t e, loss_kind kind, v128_t delta) {
+  v128_t abs = wasm_f64x2_abs(e), half = wasm_f64x2_splat(0.5);
+  switch (kind) {
+  case LOSS_L1:
+    return abs;
+  case LOSS_HUBER: {
+    v128_t c = wasm_f64x2_min(abs, delta);
+    return wasm_f64x2_mul(c, wasm_f64x2_sub(abs, wasm_f64x2_mul(half, c)));
+  }
+  case LOSS_L2:
+    break;
+  }
+  return wasm_f64x2_mul(half, wasm_f64x2_mul(e, e));
+}
+#endif
+
+_KERNEL fit_sums _batch_fit_sums(const double *x, const double *y,
+                                 const double *w, size_t n, double a, double b,
+                                 loss_kind kind, double delta, int weighted) {
+  size_t i = 0;
+  fit_sums s = {0, 0, 0, 0};
+#if defined(__AVX__)
+  __m256d va = _mm256_set1_pd(a), vb = _mm256_set1_pd(b);
+  __m256d vd = _mm256_set1_pd(delta);
+  __m256d se0 = _mm256_setzero_pd(), sex0 = _mm256_setzero_pd();
+  __m256d se1 = _mm256_setzero_pd(), sex1 = _mm256_setzero_pd();
+  __m256d sl0 = _mm256_setzero_pd(), sl1 = _mm256_setzero_pd();
+  __m256d sw = _mm256_setzero_pd();
+  for (; i + 8 <= n; i += 8) {
+    __m256d x0 = _mm256_loadu_pd(x + i), x1 = _mm256_loadu_pd(x + i + 4);
+    __m256d y0 = _mm256_loadu_pd(y + i), y1 = _mm256_loadu_pd(y + i + 4);
+    __m256d e0 = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(va, x0), vb), y0);
+    __m256d e1 = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(va, x1), vb), y1);
+    __m256d l0 = _loss256(e0, kind, vd), l1 = _loss256(e1, kind, vd);
+    e0 = _slope256(e0, kind, vd);
+    e1 = _slope256(e1, kind, vd);
+    if (weighted) {
+      __m256d w0 = _mm256_loadu_pd(w + i), w1 = _mm256_loadu_pd(w + i + 4);
+      l0 = _mm256_mul_pd(l0, w0);
+      l1 = _mm256_mul_pd(l1, w1);
+      e0 = _mm256_mul_pd(e0, w0);
+      e1 = _mm256_mul_pd(e1, w1);
+      sw = _mm256_add_pd(sw, _mm256_add_pd(w0, w1));
+    }
+    sl0 = _mm256_add_pd(sl0, l0);
+    sl1 = _mm256_add_pd(sl1, l1);
+    se0 = _mm256_add_pd(se0, e0);
+    se1 = _mm256_add_pd(se1, e1);
+    sex0 = _mm256_add_pd(sex0, _mm256_mul_pd(e0, x0));
+    sex1 = _mm256_add_pd(sex1, _mm256_mul_pd(e1, x1));
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(se0, se1));
+  s.e = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  _mm256_storeu_pd(lanes, _mm256_add_pd(sex0, sex1));
+  s.ex = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  _mm256_storeu_pd(lanes, _mm256_add_pd(sl0, sl1));
+  s.loss = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  _mm256_storeu_pd(lanes, sw);
+  s.w = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(__SSE2__)
+  __m128d va = _mm_set1_pd(a), vb = _mm_set1_pd(b), vd = _mm_set1_pd(delta);
+  __m128d se0 = _mm_setzero_pd(), sex0 = _mm_setzero_pd();
+  __m128d se1 = _mm_setzero_pd(), sex1 = _mm_setzero_pd();
+  __m128d sl0 = _mm_setzero_pd(), sl1 = _mm_setzero_pd(), sw = _mm_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    __m128d x0 = _mm_loadu_pd(x + i), x1 = _mm_loadu_pd(x + i + 2);
+    __m128d y0 = _mm_loadu_pd(y + i), y1 = _mm_loadu_pd(y + i + 2);
+    __m128d e0 = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(va, x0), vb), y0);
+    __m128d e1 = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(va, x1), vb), y1);
+    __m128d l0 = _loss128(e0, kind, vd), l1 = _loss128(e1, kind, vd);
+    e0 = _slope128(e0, kind, vd);
+    e1 = _slope128(e1, kind, vd);
+    if (weighted) {
+      __m128d w0 = _mm_loadu_pd(w + i), w1 = _mm_loadu_pd(w + i + 2);
+      l0 = _mm_mul_pd(l0, w0);
+      l1 = _mm_mul_pd(l1, w1);
+      e0 = _mm_mul_pd(e0, w0);
+      e1 = _mm_mul_pd(e1, w1);
+      sw = _mm_add_pd(sw, _mm_add_pd(w0, w1));
+    }
+    sl0 = _mm_add_pd(sl0, l0);
+    sl1 = _mm_add_pd(sl1, l1);
+    se0 = _mm_add_pd(se0, e0);
+    se1 = _mm_add_pd(se1, e1);
+    sex0 = _mm_add_pd(sex0, _mm_mul_pd(e0, x0));
+    sex1 = _mm_add_pd(sex1, _mm_mul_pd(e1, x1));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(se0, se1));
+  s.e = lanes[0] + lanes[1];
+  _mm_storeu_pd(lanes, _mm_add_pd(sex0, sex1));
+  s.ex = lanes[0] + lanes[1];
+  _mm_storeu_pd(lanes, _mm_add_pd(sl0, sl1));
+  s.loss = lanes[0] + lanes[1];
+  _mm_storeu_pd(lanes, sw);
+  s.w = lanes[0] + lanes[1];
+#elif defined(__wasm_simd128__)
+  v128_t va = wasm_f64x2_splat(a), vb = wasm_f64x2_splat(b);
+  v128_t vd = wasm_f64x2_splat(delta);
+  v128_t se0 = wasm_f64x2_splat(0), sex0 = wasm_f64x2_splat(0);
+  v128_t se1 = wasm_f64x2_splat(0), sex1 = wasm_f64x2_splat(0);
+  v128_t sl0 = wasm_f64x2_splat(0), sl1 = wasm_f64x2_splat(0);
+  v128_t sw = wasm_f64x2_splat(0);
+  for (; i + 4 <= n; i += 4) {
+    v128_t x0 = wasm_v128_load(x + i), x1 = wasm_v128_load(x + i + 2);
+    v128_t y0 = wasm_v128_load(y + i), y1 = wasm_v128_load(y + i + 2);
+    v128_t e0 = wasm_f64x2_sub(wasm_f64x2_add(wasm_f64x2_mul(va, x0), vb), y0);
+    v128_t e1 = wasm_f64x2_sub(wasm_f64x2_add(wasm_f64x2_mul(va, x1), vb), y1);
+    v128_t l0 = _loss128(e0, kind, vd), l1 = _loss128(e1, kind, vd);
+    e0 = _slope128(e0, kind, vd);
+    e1 = _slope128(e1, kind, vd);
+    if (weighted) {
+      v128_t w0 = wasm_v128_load(w + i), w1 = wasm_v128_load(w + i + 2);
+      l0 = wasm_f64x2_mul(l0, w0);
+      l1 = wasm_f64x2_mul(l1, w1);
+      e0 = wasm_f64x2_mul(e0, w0);
+      e1 = wasm_f64x2_mul(e1, w1);
+      sw = wasm_f64x2_add(sw, wasm_f64x2_add(w0, w1));
+    }
+    sl0 = wasm_f64x2_add(sl0, l0);
+    sl1 = wasm_f64x2_add(sl1, l1);
+    se0 = wasm_f64x2_add(se0, e0);
+    se1 = wasm_f64x2_add(se1, e1);
+    sex0 = wasm_f64x2_add(sex0, wasm_f64x2_mul(e0, x0));
+    sex1 = wasm_f64x2_add(sex1, wasm_f64x2_mul(e1, x1));
+  }
+  v128_t se = wasm_f64x2_add(se0, se1), sex = wasm_f64x2_add(sex0, sex1);
+  v128_t sl = wasm_f64x2_add(sl0, sl1);
+  s.e = wasm_f64x2_extract_lane(se, 0) + wasm_f64x2_extract_lane(se, 1);
+  s.ex = wasm_f64x2_extract_lane(sex, 0) + wasm_f64x2_extract_lane(sex, 1);
+  s.loss = wasm_f64x2_extract_lane(sl, 0) + wasm_f64x2_extract_lane(sl, 1);
+  s.w = wasm_f64x2_extract_lane(sw, 0) + wasm_f64x2_extract_lane(sw, 1);
+#endif
+  fit_sums tail = _fit_sums_scalar(x + i, y + i, weighted ? w + i : NULL,
+                                   n - i, a, b, kind, delta, weighted);
+  s.e += tail.e;
+  s.ex += tail.ex;
+  s.loss += tail.loss;
+  s.w = weighted ? s.w + tail.w : n;
+  return s;
+}
+
+// Σ slope(error), Σ slope(error) * x, Σ loss(error) and Σ weight for
+// y = a * x + b over the n points of the x and y columns, in one pass. w is
+// the weight column, or NULL when every weight is 1.
+static inline fit_sums batch_fit_sums(const double *x, const double *y,
+                                      const double *w, size_t n, double a,
+                                      double b, loss_kind kind, double delta) {
+  if (w != NULL)
+    switch (kind) {
+    case LOSS_L1:
+      return _batch_fit_sums(x, y, w, n, a, b, LOSS_L1, delta, 1);
+    case LOSS_HUBER:
+      return _batch_fit_sums(x, y, w, n, a, b, LOSS_HUBER, delta, 1);
+    case LOSS_L2:
+      return _batch_fit_sums(x, y, w, n, a, b, LOSS_L2, delta, 1);
+    }
+  switch (kind) {
+  case LOSS_L1:
+    return _batch_fit_sums(x, y, NULL, n, a, b, LOSS_L1, delta, 0);
+  case LOSS_HUBER:
+    return _batch_fit_sums(x, y, NULL, n, a, b, LOSS_HUBER, delta, 0);
+  case LOSS_L2:
+    break;
+  }
+  return _batch_fit_sums(x, y, NULL, n, a, b, LOSS_L2, delta, 0);
+}
@@ -1,37 +1,203 @@
 #pragma once
 
+#include "optimizer.h"
+#include "reduce.h"
 #include "user_points.h"
-#include <gama.h>
+
+typedef enum {
+  TRAIN_SGD,       // one update per point, the original animation
+  TRAIN_BATCH,     // one update per epoch from the full gradient
+  TRAIN_MINIBATCH, // one update per batch_size points
+} train_mode;
 
 double gradient = 0, intercept = 0;
 
+// weighted mean of loss_value() over the points, for the loss being
+// minimized. After an epoch it is the loss that epoch saw on its way through
+// the points, one epoch behind the line, which saves training frames a
+// separate scan.
 double loss = 0;
 double learn_rate = 0.01;
 
+loss_kind loss_type = LOSS_L2;
+double huber_delta = 0.1;
+
+// exact mode: closed-form least squares from user_stats, O(1) per frame
+int exact_fit = 0;
+
+train_mode training = TRAIN_SGD;
+size_t batch_size = 32;
+
+optimizer opt = OPTIMIZER_INIT(LINEUP_OPTIMIZER);
+
+// mean gradient over the last epoch and the largest parameter change it made
+double epoch_grads[2] = {0, 0};
+double epoch_step = 0;
+
 static inline double find_y(double x) { return (gradient * x) + intercept; }
 
 static inline double find_x(double y) { return (y - intercept) / gradient; }
 
+// what `loss` was last computed for, idle frames reuse it without a scan
+struct {
+  int valid;
+  unsigned long version;
+  double gradient, intercept;
+  loss_kind kind;
+  double delta;
+} _loss_cache;
+
+// set by one_epoch(), plot_line() then keeps the epoch's loss
+int loss_from_epoch = 0;
+
+static void _cache_loss(double a, double b) {
+  _loss_cache.valid = 1;
+  _loss_cache.version = points_version;
+  _loss_cache.gradient = a;
+  _loss_cache.intercept = b;
+  _loss_cache.kind = loss_type;
+  _loss_cache.delta = huber_delta;
+}
+
+void invalidate_loss() { _loss_cache.valid = 0; }
+
 void find_loss() {
-  loss = 0;
-  for (size_t i = 0; i < n_user_points; i++) {
-    double error = find_y(user_points[i].x) - user_points[i].y;
-    loss += fabs(error);
+  if (user_points.n == 0) {
+    loss = 0;
+    return;
   }
+  if (_loss_cache.valid && _loss_cache.version == points_version &&
+      _loss_cache.gradient == gradient && _loss_cache.intercept == intercept &&
+      _loss_cache.kind == loss_type && _loss_cache.delta == huber_delta)
+    return;
+  fit_sums s = parallel_fit_sums(user_points.x, user_points.y, user_points.w,
+                                 user_points.n, gradient, intercept, loss_type,
+                                 huber_delta);
+  loss = s.loss / s.w;
+  _cache_loss(gradient, intercept);
 }
-void plot_line() {
-  double start_x = -5, start_y = find_y(start_x);
-  double end_x = 5, end_y = find_y(end_x);
-  find_loss();
-  int loss_on_256 = fmax(log(loss) + 4, 0) * 40;
-  gmColor color = gm_set_red(GM_YELLOW, loss_on_256);
-  gm_draw_line(start_x, start_y, end_x, end_y, 0.01, color);
+
+// least squares minimizes l2 whatever loss_type says, report that one
+void fit_exact() {
+  stats_fit(&user_stats, &gradient, &intercept);
+  loss = stats_mse(&user_stats, gradient, intercept) / 2;
+}
+
+loss_kind minimized_loss() { return exact_fit ? LOSS_L2 : loss_type; }
+
+// the loss here is the running one, each point scored as it was visited. A
+// point steps in proportion to its weight over the mean weight: a step of
+// its full weight would overshoot once thousands of samples share a point.
+void sgd_epoch() {
+  double params[2] = {gradient, intercept};
+  double total[2] = {0, 0}, total_loss = 0, total_w = 0;
+  double unit = user_points.w && user_stats.n > 0 ? user_points.n / user_stats.n
+                                                  : 1;
+  for (size_t i = 0; i < user_points.n; i++) {
+    double x = user_points.x[i];
+    double w = points_weight(&user_points, i);
+    double error = params[0] * x + params[1] - user_points.y[i];
+    double slope = w * loss_slope(loss_type, huber_delta, error);
+    double grads[2] = {x * slope * unit, slope * unit};
+    total_loss += w * loss_value(loss_type, huber_delta, error);
+    total_w += w;
+    optimizer_step(&opt, params, grads, learn_rate);
+    total[0] += x * slope;
+    total[1] += slope;
+  }
+  gradient = params[0];
+  intercept = params[1];
+  epoch_grads[0] = total[0] / total_w;
+  epoch_grads[1] = total[1] / total_w;
+  loss = total_loss / total_w;
+}
+
+void batch_epoch(size_t size) {
+  if (size == 0)
+    return;
+  double total[2] = {0, 0}, total_loss = 0, total_w = 0;
+  const double *w = user_points.w;
+  for (size_t start = 0; start < user_points.n; start += size) {
+    size_t m = user_points.n - start < size ? user_points.n - start : size;
+    fit_sums s = parallel_fit_sums(user_points.x + start, user_points.y + start,
+                                   w ? w + start : NULL, m, gradient, intercept,
+                                   loss_type, huber_delta);
+    double params[2] = {gradient, intercept};
+    double grads[2] = {s.ex / s.w, s.e / s.w};
+    optimizer_step(&opt, params, grads, learn_rate);
+    gradient = params[0];
+    intercept = params[1];
+    total[0] += s.ex;
+    total[1] += s.e;
+    total_loss += s.loss;
+    total_w += s.w;
+  }
+  epoch_grads[0] = total[0] / total_w;
+  epoch_grads[1] = total[1] / total_w;
+  loss = total_loss / total_w;
 }
 
 void one_epoch() {
-  for (size_t i = 0; i < n_user_points; i++) {
-    double error = find_y(user_points[i].x) - user_points[i].y;
-    gradient -= learn_rate * user_points[i].x * error;
-    intercept -= learn_rate * error;
+  if (exact_fit || user_points.n == 0)
+    return;
+  double before[2] = {gradient, intercept};
+  switch (training) {
+  case TRAIN_SGD:
+    sgd_epoch();
+    break;
+  case TRAIN_BATCH:
+    batch_epoch(user_points.n);
+    break;
+  case TRAIN_MINIBATCH:
+    batch_epoch(batch_size);
+    break;
   }
+  epoch_step = fmax(fabs(gradient - before[0]), fabs(intercept - before[1]));
+  // only exact when every point saw the starting parameters
+  if (training == TRAIN_BATCH || epoch_step == 0)
+    _cache_loss(before[0], before[1]);
+  else
+    invalidate_loss();
+  loss_from_epoch = 1;
 }
+
+const char *train_mode_name() {
+  switch (training) {
+  case TRAIN_SGD:
+    return "stochastic";
+  case TRAIN_BATCH:
+    return "batch";
+  case TRAIN_MINIBATCH:
+    return "mini-batch";
+  }
+  return "";
+}
+
+void set_optimizer(optimizer_kind kind) {
+  opt.kind = kind;
+  optimizer_reset(&opt);
+}
+
+#ifndef LINEUP_HEADLESS
+
+void plot_line() {
+  if (exact_fit)
+    fit_exact();
+  else if (!loss_from_epoch)
+    find_loss();
+  loss_from_epoch = 0;
+  // across the view, under view_camera()
+  double left, bottom, right, top;
+  gm_camera_bounds(&left, &bottom, &right, &top);
+  double start_x = left, start_y = find_y(start_x);
+  double end_x = right, end_y = find_y(end_x);
+  // gama's log series crawls near 0 and never returns on inf, below e^-4
+  // the result is clamped to 0 anyway
+  int loss_on_256 = loss > 1e9      ? 255
+                    : loss > 0.0184 ? fmax(log(loss) + 4, 0) * 40
+                                    : 0;
+  gmColor color = gm_set_red(GM_YELLOW, loss_on_256);
+  gm_draw_line(start_x, start_y, end_x, end_y, 0.01, color);
+}
+
+#endif
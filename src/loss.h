@@ -0,0 +1,58 @@
+#pragma once
+
+// Per-point losses of the residual e = (gradient * x + intercept) - y and
+// their derivative with respect to e, which is all the training needs: the
+// parameter gradients are slope * x and slope.
+//
+//   l1     |e|                                  slope sign(e), 0 at 0
+//   l2     e²/2                                 slope e
+//   huber  e²/2 if |e| <= delta                 slope e clamped to ±delta
+//          delta * (|e| - delta/2) otherwise
+//
+// l2 is halved so that its slope is the plain residual, which keeps the
+// update rule and learn_rate scale of the original per-point SGD.
+
+typedef enum {
+  LOSS_L1,
+  LOSS_L2,
+  LOSS_HUBER,
+} loss_kind;
+
+#define LOSS_COUNT (LOSS_HUBER + 1)
+
+static inline double loss_value(loss_kind kind, double delta, double e) {
+  double a = e < 0 ? -e : e;
+  switch (kind) {
+  case LOSS_L1:
+    return a;
+  case LOSS_L2:
+    return e * e / 2;
+  case LOSS_HUBER:
+    return a <= delta ? e * e / 2 : delta * (a - delta / 2);
+  }
+  return 0;
+}
+
+static inline double loss_slope(loss_kind kind, double delta, double e) {
+  switch (kind) {
+  case LOSS_L1:
+    return (e > 0) - (e < 0);
+  case LOSS_L2:
+    return e;
+  case LOSS_HUBER:
+    return e > delta ? delta : e < -delta ? -delta : e;
+  }
+  return 0;
+}
+
+static inline const char *loss_name(loss_kind kind) {
+  switch (kind) {
+  case LOSS_L1:
+    return "l1";
+  case LOSS_L2:
+    return "l2";
+  case LOSS_HUBER:
+    return "huber";
+  }
+  return "";
+}
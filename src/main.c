@@ -1,28 +1,67 @@
 #define GM_SETUP
-#define GM_MALLOC
 #define GM_MATH
 
+// gama's allocator serves the web build from a static pool. It is not
+// thread safe, and glibc allocates from inside pthread_create and stdio, so
+// native builds with their worker and stream threads keep libc's malloc.
+#ifdef __ZIG_CC__
+#define GM_MALLOC
+#define MEMORY 64
+// the point store makes few, large allocations, the default of one spot per
+// 100 bytes would cost more bookkeeping than points
+#define MEMORY_SPOTS 4096
+#endif
+
+#include "compact.h"
+#include "convergence.h"
+#include "dataset.h"
+#include "density.h"
+#include "generate.h"
 #include "gridlines.h"
+#include "journal.h"
 #include "line.h"
+#include "schedule.h"
+#include "stream.h"
 #include "user_points.h"
 #include "utils.h"
 #include <gama.h>
 
+int autoplay;
+double swanim, exactanim;
+
 void show_text_messages() {
   char txt[50] = {0};
-  sprintf(txt, "loss: %.4lf", loss);
+  sprintf(txt, "%s loss: %.4lf", loss_name(minimized_loss()), loss);
   gm_draw_text(0, 0.9, txt, "", 0.1, GM_WHITE);
   sprintf(txt, "y = %.3lfx + %.3lf", gradient, intercept);
   gm_draw_text(0, 0.8, txt, "", 0.1, GM_WHITE);
+  if (training == TRAIN_MINIBATCH)
+    sprintf(txt, "%s (%zu), %s", train_mode_name(), batch_size,
+            optimizer_name(opt.kind));
+  else
+    sprintf(txt, "%s, %s", train_mode_name(), optimizer_name(opt.kind));
+  gm_draw_text(0, 0.7, txt, "", 0.07, GM_GRAY);
+  if (autoplay && converged) {
+    gm_draw_text(0, 0.63, "converged, idle", "", 0.06, GM_GREENYELLOW);
+  } else if (autoplay && epochs_last_frame > 0) {
+    sprintf(txt, "%zu epochs/frame, %.0lf epochs/s", epochs_last_frame,
+            epochs_per_second);
+    gm_draw_text(0, 0.63, txt, "", 0.06, GM_GRAY);
+  }
+  stream_counters feed = stream_stats();
+  if (feed.active) {
+    sprintf(txt, "stream: %lu in, %lu dropped, %lu stalls", feed.ingested,
+            feed.dropped, feed.stalls);
+    gm_draw_text(0, 0.57, txt, "", 0.06, GM_GRAY);
+  }
 }
+// under view_camera()
 void show_pointer_position() {
-  if (selected_point == -1)
-    show_position(gm_mouse.position.x, gm_mouse.position.y, GM_GRAY);
+  gmPos pointer = to_data(gm_mouse.position);
+  if (selected_point() == -1)
+    show_position(pointer.x, pointer.y, GM_GRAY);
 }
 
-int autoplay;
-double swanim;
-
 gmPos joy = {0, 0}, joyv;
 
 double learn_scaled, learn_anim;
@@ -33,8 +72,34 @@ int setup() {
   gm_fullscreen(1);
   gm_show_fps(1);
 
+  const char *threads = getenv("LINEUP_THREADS");
+  pool_set_threads(threads ? strtoul(threads, NULL, 10) : 0);
+  const char *budget = getenv("LINEUP_EPOCH_BUDGET_MS");
+  if (budget)
+    epoch_budget = strtod(budget, NULL) / 1000;
+  const char *threshold = getenv("LINEUP_DENSITY_THRESHOLD");
+  if (threshold)
+    density_threshold = strtoul(threshold, NULL, 10);
+  const char *data = getenv("LINEUP_DATA");
+  if (data && load_points(data) < 0)
+    gm_log("could not open LINEUP_DATA");
+  const char *spec = getenv("LINEUP_GENERATE");
+  if (spec) {
+    generator g = default_generator;
+    long n = generator_parse(&g, spec);
+    if (n < 0 || generate_points(&g, n) < 0)
+      gm_log("could not generate LINEUP_GENERATE");
+  }
+  const char *feed = getenv("LINEUP_STREAM");
+  if (feed && !stream_open(feed, 1, getenv("LINEUP_STREAM_DROP") != NULL))
+    gm_log("could not open LINEUP_STREAM");
+  const char *tolerance = getenv("LINEUP_COMPACT");
+  if (tolerance && compact_user_points(strtod(tolerance, NULL)) < 0)
+    gm_log("could not compact the points");
+
   autoplay = 1;
   swanim = autoplay;
+  exactanim = exact_fit;
 
   joyv = joy;
 
@@ -44,17 +109,30 @@ int setup() {
 }
 
 int loop() {
+  stream_drain();
+  watch_convergence();
+  // the plane goes through the view's camera, the UI stays put over it
+  gm_camera_set(view_camera());
   draw_gridlines();
   show_selected_point_position();
-  show_text_messages();
-  plot_user_points();
+  plot_points();
   plot_line();
+  gm_camera_set(gm_camera_identity);
+  show_text_messages();
 
-  int controls_hovered = gmw_frame(1, 0.75, 0.45, 0.36);
-  if (!controls_hovered)
+  int controls_hovered = gmw_frame(1, 0.65, 0.45, 0.56);
+  if (!controls_hovered) {
+    gm_camera_set(view_camera());
     show_pointer_position();
+    gm_camera_set(gm_camera_identity);
+  }
   gmw_switch_anim(0.9, 0.85, 0.18, 0.09, &autoplay, &swanim);
   gm_draw_text(1.1, 0.85, "auto", "", 0.1, GM_WHITE);
+  gmw_switch_anim(0.9, 0.55, 0.18, 0.09, &exact_fit, &exactanim);
+  gm_draw_text(1.1, 0.55, "exact", "", 0.1, GM_WHITE);
+  if (gmw_button(1, 0.44, 0.36, 0.08, optimizer_name(opt.kind), 0.08) &&
+      gm_mouse.clicked)
+    set_optimizer((opt.kind + 1) % OPTIMIZER_COUNT);
   gmw_scale_anim(1, 0.75, 0.4, 0.02, &learn_scaled, &learn_anim);
   if (gmw_button(1, 0.65, 0.2, 0.08, "step", 0.1) && gm_mouse.down)
     one_epoch();
@@ -63,22 +141,48 @@ int loop() {
   find_selected_point();
 
   int joy_hovered = gm_joystick_anim(-1.18, 0.78, 0.2, &joy, &joyv);
-  if (gm_mouse.clicked && selected_point == -1) {
+  // each click starts a new gesture, a drag or pan undoes as one edit
+  if (gm_mouse.clicked)
+    journal_seal();
+  if (gm_mouse.clicked && selected_point() == -1) {
     if (!controls_hovered && !joy_hovered)
-      add_user_point(gm_mouse.position.x, gm_mouse.position.y);
+      journal_add_point(to_data(gm_mouse.position).x,
+                        to_data(gm_mouse.position).y);
   } else if (gm_mouse.down) {
-    if (selected_point >= 0)
-      user_points[selected_point] = gm_mouse.position;
+    if (selected_point() >= 0)
+      journal_move_point(selected_point(), to_data(gm_mouse.position));
   } else if (gm_key('d') || gm_key_down('s', 'd')) {
-    delete_selected_point();
+    journal_delete_selected();
   }
-
-  if (gm_key(' ') || autoplay) {
+  if (key_pressed('u'))
+    undo_edit();
+  if (key_pressed('r'))
+    redo_edit();
+
+  if (autoplay && !converged) {
+    train_frame();
+    check_convergence();
+  } else if (gm_key(' '))
     one_epoch();
-  }
   if (gm_key('a'))
     autoplay = !autoplay;
-  move_points(joy);
+  if (key_pressed('x'))
+    exact_fit = !exact_fit;
+  if (key_pressed('m'))
+    training = (training + 1) % (TRAIN_MINIBATCH + 1);
+  if (key_pressed('l'))
+    loss_type = (loss_type + 1) % LOSS_COUNT;
+  if (key_pressed('o'))
+    set_optimizer((opt.kind + 1) % OPTIMIZER_COUNT);
+  if (key_pressed(']'))
+    epoch_budget *= 2;
+  if (key_pressed('[') && epoch_budget > 0.0005)
+    epoch_budget /= 2;
+  journal_pan(joy);
+  if (gm_key('='))
+    zoom_view(1.02);
+  if (gm_key('-'))
+    zoom_view(1 / 1.02);
 
   if (gm_key('f'))
     learn_scaled += gm_key('S') ? -0.01 : 0.01;
@@ -0,0 +1,106 @@
+#pragma once
+
+// Update rules for the line parameters, params[0] is the gradient (slope)
+// and params[1] the intercept. Each optimizer keeps its own state between
+// steps, call optimizer_reset() when the problem changes under it.
+
+#include <stddef.h>
+
+typedef enum {
+  OPT_SGD,
+  OPT_MOMENTUM,
+  OPT_NESTEROV,
+  OPT_RMSPROP,
+  OPT_ADAM,
+} optimizer_kind;
+
+#define OPTIMIZER_COUNT (OPT_ADAM + 1)
+
+#ifndef LINEUP_OPTIMIZER
+#define LINEUP_OPTIMIZER OPT_SGD
+#endif
+
+typedef struct {
+  optimizer_kind kind;
+  double beta1; // momentum, Adam first moment decay
+  double beta2; // RMSprop and Adam second moment decay
+  double eps;
+
+  double v[2]; // velocity or first moment
+  double s[2]; // second moment
+  double beta1_t, beta2_t; // beta^t for Adam bias correction
+} optimizer;
+
+// a fresh optimizer, also usable as a static initializer
+#define OPTIMIZER_INIT(k)                                                      \
+  {.kind = (k),                                                                \
+   .beta1 = 0.9,                                                               \
+   .beta2 = 0.999,                                                             \
+   .eps = 1e-8,                                                                \
+   .beta1_t = 1,                                                               \
+   .beta2_t = 1}
+
+static inline optimizer optimizer_create(optimizer_kind kind) {
+  return (optimizer)OPTIMIZER_INIT(kind);
+}
+
+static inline void optimizer_reset(optimizer *o) {
+  *o = optimizer_create(o->kind);
+}
+
+// hardware sqrt, gama's Newton iteration is too slow for per-point updates
+static inline double _opt_sqrt(double x) { return __builtin_sqrt(x); }
+
+static inline void optimizer_step(optimizer *o, double *params,
+                                  const double *grads, double learn_rate) {
+  switch (o->kind) {
+  case OPT_SGD:
+    for (int i = 0; i < 2; i++)
+      params[i] -= learn_rate * grads[i];
+    break;
+  case OPT_MOMENTUM:
+    for (int i = 0; i < 2; i++) {
+      o->v[i] = o->beta1 * o->v[i] + grads[i];
+      params[i] -= learn_rate * o->v[i];
+    }
+    break;
+  case OPT_NESTEROV:
+    for (int i = 0; i < 2; i++) {
+      o->v[i] = o->beta1 * o->v[i] + grads[i];
+      params[i] -= learn_rate * (grads[i] + o->beta1 * o->v[i]);
+    }
+    break;
+  case OPT_RMSPROP:
+    for (int i = 0; i < 2; i++) {
+      o->s[i] = o->beta2 * o->s[i] + (1 - o->beta2) * grads[i] * grads[i];
+      params[i] -= learn_rate * grads[i] / (_opt_sqrt(o->s[i]) + o->eps);
+    }
+    break;
+  case OPT_ADAM:
+    o->beta1_t *= o->beta1;
+    o->beta2_t *= o->beta2;
+    for (int i = 0; i < 2; i++) {
+      o->v[i] = o->beta1 * o->v[i] + (1 - o->beta1) * grads[i];
+      o->s[i] = o->beta2 * o->s[i] + (1 - o->beta2) * grads[i] * grads[i];
+      double m = o->v[i] / (1 - o->beta1_t), s = o->s[i] / (1 - o->beta2_t);
+      params[i] -= learn_rate * m / (_opt_sqrt(s) + o->eps);
+    }
+    break;
+  }
+}
+
+static inline const char *optimizer_name(optimizer_kind kind) {
+  switch (kind) {
+  case OPT_SGD:
+    return "sgd";
+  case OPT_MOMENTUM:
+    return "momentum";
+  case OPT_NESTEROV:
+    return "nesterov";
+  case OPT_RMSPROP:
+    return "rmsprop";
+  case OPT_ADAM:
+    return "adam";
+  }
+  return "";
+}
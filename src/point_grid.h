@@ -0,0 +1,194 @@
+#pragma once
+
+// Uniform grid over a point_store, for finding the point under the mouse.
+//
+// The plane is cut into square cells of side `cell`, hashed into a power of
+// two number of buckets. Each bucket chains its points through `next`, so
+// insert and remove touch one bucket. A lookup with a radius up to `cell`
+// visits the 3x3 cells around the query and compares squared distances.
+//
+// Cell coordinates come from a truncating cast and the hashing is integer
+// only: no floor, sqrt or pow, which the gama math build runs as series.
+
+#include "point_store.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define GRID_NONE UINT32_MAX
+#define GRID_MIN_BUCKETS 64
+
+typedef struct {
+  double cell, inv_cell;
+  uint32_t *head; // per bucket, first point or GRID_NONE
+  uint32_t *next; // per point, next point in the same bucket
+  size_t buckets, capacity;
+  int built; // 0 until grid_build(), updates are skipped until then
+} point_grid;
+
+// cell coordinates stop at +-GRID_COORD_LIMIT: casting a double past int64,
+// or NaN, is undefined. The limit leaves room for the differences and
+// neighbours of grid_visit() and grid_find().
+#define GRID_COORD_LIMIT 0x1p61
+
+// whether v has a cell of its own rather than a clamped one
+static inline int _grid_in_range(double v, double inv_cell) {
+  double scaled = v * inv_cell;
+  return scaled > -GRID_COORD_LIMIT && scaled < GRID_COORD_LIMIT;
+}
+
+static inline int64_t _grid_coord(double v, double inv_cell) {
+  double scaled = v * inv_cell;
+  if (!(scaled > -GRID_COORD_LIMIT))
+    return scaled != scaled ? 0 : -(int64_t)GRID_COORD_LIMIT;
+  if (scaled >= GRID_COORD_LIMIT)
+    return (int64_t)GRID_COORD_LIMIT;
+  int64_t c = (int64_t)scaled;
+  return c > scaled ? c - 1 : c;
+}
+
+static inline size_t _grid_bucket(const point_grid *g, int64_t cx, int64_t cy) {
+  uint64_t h = (uint64_t)cx * 0x9E3779B97F4A7C15ull ^
+               (uint64_t)cy * 0xC2B2AE3D27D4EB4Full;
+  return (h ^ h >> 29) & (g->buckets - 1);
+}
+
+static inline size_t _grid_point_bucket(const point_grid *g,
+                                        const point_store *s, size_t i) {
+  return _grid_bucket(g, _grid_coord(s->x[i], g->inv_cell),
+                      _grid_coord(s->y[i], g->inv_cell));
+}
+
+void grid_free(point_grid *g) {
+  free(g->head);
+  free(g->next);
+  g->head = g->next = NULL;
+  g->buckets = g->capacity = 0;
+  g->built = 0;
+}
+
+// (re)indexes every point of s, leaves the grid unbuilt when out of memory
+void grid_build(point_grid *g, const point_store *s, double cell) {
+  size_t buckets = GRID_MIN_BUCKETS;
+  while (buckets < s->n)
+    buckets *= 2;
+  grid_free(g);
+  g->cell = cell;
+  g->inv_cell = 1 / cell;
+  g->head = malloc(buckets * sizeof(uint32_t));
+  g->next = malloc((s->capacity > 0 ? s->capacity : 1) * sizeof(uint32_t));
+  if (g->head == NULL || g->next == NULL) {
+    grid_free(g);
+    return;
+  }
+  g->buckets = buckets;
+  g->capacity = s->capacity > 0 ? s->capacity : 1;
+  for (size_t b = 0; b < buckets; b++)
+    g->head[b] = GRID_NONE;
+  for (size_t i = 0; i < s->n; i++) {
+    size_t b = _grid_point_bucket(g, s, i);
+    g->next[i] = g->head[b];
+    g->head[b] = i;
+  }
+  g->built = 1;
+}
+
+// indexes point i, after it was added or moved
+void grid_insert(point_grid *g, const point_store *s, size_t i) {
+  if (!g->built)
+    return;
+  // rehash as the points outgrow the buckets, amortized O(1)
+  if (s->n > 2 * g->buckets) {
+    grid_build(g, s, g->cell);
+    return;
+  }
+  if (i >= g->capacity) {
+    uint32_t *next = realloc(g->next, s->capacity * sizeof(uint32_t));
+    if (next == NULL) {
+      grid_free(g);
+      return;
+    }
+    g->next = next;
+    g->capacity = s->capacity;
+  }
+  size_t b = _grid_point_bucket(g, s, i);
+  g->next[i] = g->head[b];
+  g->head[b] = i;
+}
+
+// indexes the points from first to the end of s, appended together. A
+// rehash covers them all at once, so none is linked twice.
+void grid_insert_from(point_grid *g, const point_store *s, size_t first) {
+  if (!g->built)
+    return;
+  if (s->n > 2 * g->buckets) {
+    grid_build(g, s, g->cell);
+    return;
+  }
+  for (size_t i = first; i < s->n && g->built; i++)
+    grid_insert(g, s, i);
+}
+
+// unlinks point i, before it is moved or deleted
+void grid_remove(point_grid *g, const point_store *s, size_t i) {
+  if (!g->built)
+    return;
+  uint32_t *link = &g->head[_grid_point_bucket(g, s, i)];
+  while (*link != GRID_NONE && *link != i)
+    link = &g->next[*link];
+  if (*link == i)
+    *link = g->next[i];
+}
+
+typedef int (*point_visitor)(size_t i, void *ctx);
+
+// Calls visit(i, ctx) for the points of s inside [x0, x1] x [y0, y1], until
+// it returns 0. When the rectangle covers few cells compared to the points,
+// its cells are walked, so the cost follows what is inside; otherwise, or
+// without a built grid, every point is tested.
+void grid_visit(const point_grid *g, const point_store *s, double x0, double y0,
+                double x1, double y1, point_visitor visit, void *ctx) {
+  if (g->built) {
+    int64_t cx0 = _grid_coord(x0, g->inv_cell);
+    int64_t cx1 = _grid_coord(x1, g->inv_cell);
+    int64_t cy0 = _grid_coord(y0, g->inv_cell);
+    int64_t cy1 = _grid_coord(y1, g->inv_cell);
+    if ((double)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) * 4 < s->n) {
+      for (int64_t cy = cy0; cy <= cy1; cy++)
+        for (int64_t cx = cx0; cx <= cx1; cx++)
+          for (uint32_t j = g->head[_grid_bucket(g, cx, cy)]; j != GRID_NONE;
+               j = g->next[j]) {
+            double x = s->x[j], y = s->y[j];
+            // cells share buckets, keep this cell's own points
+            if (_grid_coord(x, g->inv_cell) != cx ||
+                _grid_coord(y, g->inv_cell) != cy)
+              continue;
+            if (x >= x0 && x <= x1 && y >= y0 && y <= y1 && !visit(j, ctx))
+              return;
+          }
+      return;
+    }
+  }
+  for (size_t i = 0; i < s->n; i++) {
+    double x = s->x[i], y = s->y[i];
+    if (x >= x0 && x <= x1 && y >= y0 && y <= y1 && !visit(i, ctx))
+      return;
+  }
+}
+
+// lowest index within radius of (x, y), or -1. radius must not exceed the
+// cell size, the grid must be built.
+long grid_find(const point_grid *g, const point_store *s, double x, double y,
+               double radius) {
+  int64_t cx = _grid_coord(x, g->inv_cell), cy = _grid_coord(y, g->inv_cell);
+  double r2 = radius * radius;
+  long found = -1;
+  for (int64_t dy = -1; dy <= 1; dy++)
+    for (int64_t dx = -1; dx <= 1; dx++)
+      for (uint32_t j = g->head[_grid_bucket(g, cx + dx, cy + dy)];
+           j != GRID_NONE; j = g->next[j]) {
+        double ex = s->x[j] - x, ey = s->y[j] - y;
+        if (ex * ex + ey * ey < r2 && (found < 0 || j < (size_t)found))
+          found = j;
+      }
+  return found;
+}
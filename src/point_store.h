@@ -0,0 +1,271 @@
+#pragma once
+
+// Growable structure-of-arrays point storage.
+//
+// x and y live in two columns of one allocation, each starting on a 64-byte
+// boundary so the kernels stream whole cache lines. The capacity doubles
+// when full, which keeps appends amortized O(1).
+//
+// Removal swaps the last point into the hole, so indices are not stable.
+// Every point also gets an id, never reused, that keeps naming it: `id`
+// maps index to id and `index_of` id to index. Until the first removal
+// ids equal indices, and both tables stay unallocated.
+//
+// Points may carry a weight, a point of weight w standing for w copies of
+// it. The `w` column is likewise only allocated once a weight differs from 1.
+//
+// The columns may also be a private file mapping (points_adopt_mapping),
+// which the OS copies page by page on write; growing the store moves them
+// to the heap.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(__ZIG_CC__) && (defined(__unix__) || defined(__APPLE__))
+#define POINT_STORE_MMAP
+#include <sys/mman.h>
+#endif
+
+#define POINT_STORE_ALIGN 64
+#define POINT_STORE_MIN_CAPACITY 64
+#define POINT_NONE UINT32_MAX
+
+typedef struct {
+  double *x, *y;
+  size_t n, capacity;
+  void *_block;   // what malloc returned, x is aligned inside it
+  size_t _mapped; // when non-zero, _block is a mapping of that many bytes
+  uint32_t *id;       // per index, NULL while ids equal indices
+  uint32_t *index_of; // per id, POINT_NONE once removed
+  size_t next_id, id_capacity;
+  double *w; // per index, NULL while every weight is 1
+} point_store;
+
+static inline uint32_t points_id(const point_store *s, size_t i) {
+  return s->id ? s->id[i] : i;
+}
+
+static inline double points_weight(const point_store *s, size_t i) {
+  return s->w ? s->w[i] : 1;
+}
+
+// allocates the weight column, every point at weight 1, 0 when out of memory
+int points_track_weights(point_store *s) {
+  if (s->w)
+    return 1;
+  double *w = malloc((s->capacity > 0 ? s->capacity : 1) * sizeof(double));
+  if (w == NULL)
+    return 0;
+  for (size_t i = 0; i < s->n; i++)
+    w[i] = 1;
+  s->w = w;
+  return 1;
+}
+
+// index of the point with this id, or POINT_NONE if it was removed
+static inline uint32_t points_index(const point_store *s, uint32_t id) {
+  if (id >= s->next_id)
+    return POINT_NONE;
+  return s->index_of ? s->index_of[id] : id;
+}
+
+// makes room for `ids` ids in index_of, 0 when out of memory
+static int _points_reserve_ids(point_store *s, size_t ids) {
+  if (ids <= s->id_capacity)
+    return 1;
+  if (ids < 2 * s->id_capacity)
+    ids = 2 * s->id_capacity;
+  uint32_t *index_of = realloc(s->index_of, ids * sizeof(uint32_t));
+  if (index_of == NULL)
+    return 0;
+  s->index_of = index_of;
+  s->id_capacity = ids;
+  return 1;
+}
+
+// switches from ids equal to indices to the explicit tables
+static int _points_track_ids(point_store *s) {
+  if (s->id)
+    return 1;
+  uint32_t *id = malloc((s->capacity > 0 ? s->capacity : 1) * sizeof(uint32_t));
+  if (id == NULL || !_points_reserve_ids(s, s->next_id + 1)) {
+    free(id);
+    return 0;
+  }
+  for (size_t i = 0; i < s->n; i++)
+    id[i] = s->index_of[i] = i;
+  s->id = id;
+  return 1;
+}
+
+// capacity rounded so the y column starts aligned too
+static inline size_t _point_store_round(size_t capacity) {
+  size_t per_line = POINT_STORE_ALIGN / sizeof(double);
+  return (capacity + per_line - 1) / per_line * per_line;
+}
+
+static void _points_release(point_store *s) {
+#ifdef POINT_STORE_MMAP
+  if (s->_mapped) {
+    munmap(s->_block, s->_mapped);
+    s->_mapped = 0;
+    return;
+  }
+#endif
+  free(s->_block);
+}
+
+// grows the store to hold at least `capacity` points, 0 when out of memory
+int points_reserve(point_store *s, size_t capacity) {
+  if (capacity <= s->capacity)
+    return 1;
+  capacity = _point_store_round(capacity);
+  void *block = malloc(2 * capacity * sizeof(double) + POINT_STORE_ALIGN - 1);
+  if (block == NULL)
+    return 0;
+  size_t offset = (POINT_STORE_ALIGN - (size_t)block % POINT_STORE_ALIGN) %
+                  POINT_STORE_ALIGN;
+  double *x = (double *)((char *)block + offset), *y = x + capacity;
+  if (s->id) {
+    uint32_t *id = realloc(s->id, capacity * sizeof(uint32_t));
+    if (id == NULL) {
+      free(block);
+      return 0;
+    }
+    s->id = id;
+  }
+  if (s->w) {
+    double *w = realloc(s->w, capacity * sizeof(double));
+    if (w == NULL) {
+      free(block);
+      return 0;
+    }
+    s->w = w;
+  }
+  if (s->n > 0) {
+    memcpy(x, s->x, s->n * sizeof(double));
+    memcpy(y, s->y, s->n * sizeof(double));
+  }
+  _points_release(s);
+  s->_block = block;
+  s->x = x;
+  s->y = y;
+  s->capacity = capacity;
+  return 1;
+}
+
+// doubles the capacity, or grows by an eighth when a fixed pool (gama's
+// malloc, on the web build) has no room left for twice the points
+static int _points_grow(point_store *s) {
+  if (s->capacity < POINT_STORE_MIN_CAPACITY)
+    return points_reserve(s, POINT_STORE_MIN_CAPACITY);
+  return points_reserve(s, 2 * s->capacity) ||
+         points_reserve(s, s->capacity + s->capacity / 8);
+}
+
+// appends a point, 0 when the store could not grow
+static inline int points_push(point_store *s, double x, double y) {
+  if (s->n == s->capacity && !_points_grow(s))
+    return 0;
+  if (s->next_id >= POINT_NONE)
+    return 0;
+  if (s->id) {
+    if (!_points_reserve_ids(s, s->next_id + 1))
+      return 0;
+    s->id[s->n] = s->next_id;
+    s->index_of[s->next_id] = s->n;
+  }
+  s->x[s->n] = x;
+  s->y[s->n] = y;
+  if (s->w)
+    s->w[s->n] = 1;
+  s->n++;
+  s->next_id++;
+  return 1;
+}
+
+// appends a removed point again under its old id, with weight w. 0 when out
+// of memory, or when the id is not a removed one.
+int points_revive(point_store *s, uint32_t id, double x, double y, double w) {
+  if (id >= s->next_id || !_points_track_ids(s) ||
+      s->index_of[id] != POINT_NONE)
+    return 0;
+  if ((w != 1 && !points_track_weights(s)) ||
+      (s->n == s->capacity && !_points_grow(s)))
+    return 0;
+  s->x[s->n] = x;
+  s->y[s->n] = y;
+  if (s->w)
+    s->w[s->n] = w;
+  s->id[s->n] = id;
+  s->index_of[id] = s->n;
+  s->n++;
+  return 1;
+}
+
+// removes point i by moving the last point into its place, O(1). Returns 0,
+// leaving the store untouched, when the id tables could not be allocated.
+int points_swap_remove(point_store *s, size_t i) {
+  if (!_points_track_ids(s))
+    return 0;
+  size_t last = s->n - 1;
+  s->index_of[s->id[i]] = POINT_NONE;
+  if (i != last) {
+    s->x[i] = s->x[last];
+    s->y[i] = s->y[last];
+    if (s->w)
+      s->w[i] = s->w[last];
+    s->id[i] = s->id[last];
+    s->index_of[s->id[i]] = i;
+  }
+  s->n--;
+  return 1;
+}
+
+// takes in the k points the caller wrote past the end of the columns, after
+// a points_reserve(), 0 when out of ids
+int points_commit(point_store *s, size_t k) {
+  if (s->next_id + k >= POINT_NONE)
+    return 0;
+  if (s->id) {
+    if (!_points_reserve_ids(s, s->next_id + k))
+      return 0;
+    for (size_t j = 0; j < k; j++) {
+      s->id[s->n + j] = s->next_id + j;
+      s->index_of[s->next_id + j] = s->n + j;
+    }
+  }
+  if (s->w)
+    for (size_t j = 0; j < k; j++)
+      s->w[s->n + j] = 1;
+  s->n += k;
+  s->next_id += k;
+  return 1;
+}
+
+#ifdef POINT_STORE_MMAP
+// makes the columns of a private mapping the store's points, without a copy.
+// Only for a store that never held a point, 0 otherwise.
+int points_adopt_mapping(point_store *s, void *mapping, size_t length,
+                         double *x, double *y, size_t n) {
+  if (s->next_id != 0 || n >= POINT_NONE)
+    return 0;
+  _points_release(s);
+  s->_block = mapping;
+  s->_mapped = length;
+  s->x = x;
+  s->y = y;
+  s->n = s->capacity = s->next_id = n;
+  return 1;
+}
+#endif
+
+void points_free(point_store *s) {
+  _points_release(s);
+  free(s->id);
+  free(s->index_of);
+  free(s->w);
+  *s = (point_store){0};
+}
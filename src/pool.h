@@ -0,0 +1,137 @@
+#pragma once
+
+// Persistent worker threads for data-parallel passes over the points.
+//
+// pool_run() splits a job into n_chunks independent chunks that the calling
+// thread and the workers pull from a shared counter, it returns once every
+// chunk is done. Callers that reduce write one partial per chunk and combine
+// the partials themselves, so results never depend on which thread ran what.
+// The web build has no workers, pool_run() runs the chunks inline there.
+
+#include <stddef.h>
+
+#ifndef POOL_MAX_THREADS
+#define POOL_MAX_THREADS 64
+#endif
+
+typedef void (*pool_task)(size_t chunk, void *ctx);
+
+// number of threads used by pool_run, including the calling thread
+size_t pool_threads = 1;
+
+#ifdef __ZIG_CC__
+
+// no threads on the web build
+size_t pool_cores() { return 1; }
+void pool_set_threads(size_t n) {
+  (void)n;
+  pool_threads = 1;
+}
+
+void pool_run(size_t n_chunks, pool_task task, void *ctx) {
+  for (size_t c = 0; c < n_chunks; c++)
+    task(c, ctx);
+}
+
+#else
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+struct _pool {
+  pthread_t threads[POOL_MAX_THREADS];
+  size_t started;
+  pthread_mutex_t lock;
+  pthread_cond_t wake, done;
+  unsigned long generation;
+  size_t active;  // workers taking part in the current job
+  size_t pending; // of those, how many are still draining
+  pool_task task;
+  void *ctx;
+  size_t n_chunks;
+  atomic_size_t next;
+} _pool = {.lock = PTHREAD_MUTEX_INITIALIZER,
+           .wake = PTHREAD_COND_INITIALIZER,
+           .done = PTHREAD_COND_INITIALIZER};
+
+size_t pool_cores() {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (size_t)n : 1;
+}
+
+// 0 picks one thread per online core
+void pool_set_threads(size_t n) {
+  if (n == 0)
+    n = pool_cores();
+  if (n > POOL_MAX_THREADS + 1)
+    n = POOL_MAX_THREADS + 1;
+  pool_threads = n;
+}
+
+static void _pool_drain() {
+  size_t c;
+  while ((c = atomic_fetch_add(&_pool.next, 1)) < _pool.n_chunks)
+    _pool.task(c, _pool.ctx);
+}
+
+static void *_pool_worker(void *arg) {
+  size_t id = (size_t)arg;
+  unsigned long seen = 0;
+  pthread_mutex_lock(&_pool.lock);
+  for (;;) {
+    while (_pool.generation == seen)
+      pthread_cond_wait(&_pool.wake, &_pool.lock);
+    seen = _pool.generation;
+    if (id >= _pool.active)
+      continue;
+    pthread_mutex_unlock(&_pool.lock);
+    _pool_drain();
+    pthread_mutex_lock(&_pool.lock);
+    if (--_pool.pending == 0)
+      pthread_cond_signal(&_pool.done);
+  }
+  return NULL;
+}
+
+void pool_run(size_t n_chunks, pool_task task, void *ctx) {
+  size_t workers = pool_threads > 1 ? pool_threads - 1 : 0;
+  if (workers > POOL_MAX_THREADS)
+    workers = POOL_MAX_THREADS;
+  if (n_chunks == 0)
+    return;
+  if (workers > n_chunks - 1)
+    workers = n_chunks - 1;
+  if (workers == 0) {
+    for (size_t c = 0; c < n_chunks; c++)
+      task(c, ctx);
+    return;
+  }
+  pthread_mutex_lock(&_pool.lock);
+  while (_pool.started < workers) {
+    if (pthread_create(&_pool.threads[_pool.started], NULL, _pool_worker,
+                       (void *)_pool.started) != 0)
+      break;
+    _pool.started++;
+  }
+  if (workers > _pool.started)
+    workers = _pool.started;
+  _pool.task = task;
+  _pool.ctx = ctx;
+  _pool.n_chunks = n_chunks;
+  atomic_store(&_pool.next, 0);
+  _pool.active = workers;
+  _pool.pending = workers;
+  _pool.generation++;
+  pthread_cond_broadcast(&_pool.wake);
+  pthread_mutex_unlock(&_pool.lock);
+
+  _pool_drain();
+
+  pthread_mutex_lock(&_pool.lock);
+  while (_pool.pending > 0)
+    pthread_cond_wait(&_pool.done, &_pool.lock);
+  pthread_mutex_unlock(&_pool.lock);
+}
+
+#endif
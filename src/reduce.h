@@ -0,0 +1,83 @@
+#pragma once
+
+// Chunked reductions over the point cloud.
+//
+// Points are cut into fixed REDUCE_CHUNK sized chunks whatever the thread
+// count, each chunk reduces into its own partial, and partials are combined
+// pairwise in index order. The summation tree therefore only depends on n,
+// which makes the results bit-identical for any value of pool_threads.
+
+#include "kernels.h"
+#include "pool.h"
+#include <stdlib.h>
+
+#ifndef REDUCE_CHUNK
+// 16k points, 256KB of x and y: fits a per-core L2, and keeps every chunk
+// on the columns' 64-byte alignment
+#define REDUCE_CHUNK 16384
+#endif
+
+typedef struct {
+  const double *x, *y, *w;
+  size_t n;
+  double a, b;
+  loss_kind kind;
+  double delta;
+  fit_sums *partial;
+} _reduce_job;
+
+static void *_reduce_partials = NULL;
+static size_t _reduce_capacity = 0;
+
+static void *_reduce_buffer(size_t n_chunks, size_t size) {
+  if (n_chunks * size > _reduce_capacity) {
+    void *buffer = realloc(_reduce_partials, n_chunks * size);
+    if (buffer == NULL)
+      return NULL;
+    _reduce_partials = buffer;
+    _reduce_capacity = n_chunks * size;
+  }
+  return _reduce_partials;
+}
+
+static inline size_t reduce_chunks(size_t n) {
+  return (n + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+}
+
+static void _reduce_chunk(size_t c, void *ctx) {
+  _reduce_job *job = ctx;
+  size_t start = c * REDUCE_CHUNK;
+  size_t m = job->n - start < REDUCE_CHUNK ? job->n - start : REDUCE_CHUNK;
+  job->partial[c] = batch_fit_sums(job->x + start, job->y + start,
+                                   job->w ? job->w + start : NULL, m, job->a,
+                                   job->b, job->kind, job->delta);
+}
+
+fit_sums parallel_fit_sums(const double *x, const double *y, const double *w,
+                           size_t n, double a, double b, loss_kind kind,
+                           double delta) {
+  size_t chunks = reduce_chunks(n);
+  if (chunks <= 1)
+    return batch_fit_sums(x, y, w, n, a, b, kind, delta);
+  fit_sums *partial = _reduce_buffer(chunks, sizeof(fit_sums));
+  if (partial == NULL)
+    return batch_fit_sums(x, y, w, n, a, b, kind, delta);
+  _reduce_job job = {.x = x,
+                     .y = y,
+                     .w = w,
+                     .n = n,
+                     .a = a,
+                     .b = b,
+                     .kind = kind,
+                     .delta = delta,
+                     .partial = partial};
+  pool_run(chunks, _reduce_chunk, &job);
+  for (size_t step = 1; step < chunks; step *= 2)
+    for (size_t i = 0; i + step < chunks; i += 2 * step) {
+      partial[i].e += partial[i + step].e;
+      partial[i].ex += partial[i + step].ex;
+      partial[i].loss += partial[i + step].loss;
+      partial[i].w += partial[i + step].w;
+    }
+  return partial[0];
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// Runs as many epochs per frame as fit in epoch_budget seconds of a
+// monotonic clock, so autoplay trains at CPU speed instead of at the
+// display refresh rate.
+
+#include "line.h"
+
+// seconds of training per rendered frame
+double epoch_budget = 0.004;
+// upper bound, keeps tiny datasets from spinning the whole budget
+size_t max_epochs_per_frame = 100000;
+
+size_t epochs_last_frame = 0;
+double epochs_per_second = 0;
+
+#ifdef __ZIG_CC__
+// no monotonic clock on the web build, run a fixed count instead
+#define SCHEDULE_HAS_CLOCK 0
+size_t fallback_epochs_per_frame = 1;
+double now_seconds() { return 0; }
+#elif defined(_WIN32)
+#define SCHEDULE_HAS_CLOCK 1
+double now_seconds() {
+  LARGE_INTEGER count, frequency;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return (double)count.QuadPart / frequency.QuadPart;
+}
+#else
+#include <time.h>
+#define SCHEDULE_HAS_CLOCK 1
+double now_seconds() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+#endif
+
+void train_frame() {
+  size_t epochs = 0;
+  if (exact_fit || user_points.n == 0) {
+    epochs_last_frame = 0;
+    return;
+  }
+#if SCHEDULE_HAS_CLOCK
+  static const double alpha = 0.9;
+  double start = now_seconds(), elapsed = 0;
+  do {
+    one_epoch();
+    epochs++;
+    elapsed = now_seconds() - start;
+  } while (elapsed < epoch_budget && epochs < max_epochs_per_frame);
+  if (elapsed > 0) {
+    double rate = epochs / elapsed;
+    epochs_per_second = epochs_per_second == 0
+                            ? rate
+                            : epochs_per_second * alpha + rate * (1 - alpha);
+  }
+#else
+  for (; epochs < fallback_epochs_per_frame; epochs++)
+    one_epoch();
+  if (gm_dt() > 0)
+    epochs_per_second = epochs / gm_dt();
+#endif
+  epochs_last_frame = epochs;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stddef.h>
+
+// Sufficient statistics of a point cloud for the least squares line.
+//
+// Sums are kept centered (Welford) rather than as raw Σx, Σy, Σxy, Σx², Σy²:
+// the raw sums are n·mean and co-moment + n·mean², but subtracting those back
+// cancels catastrophically once the cloud is large or far from the origin.
+// Every update is O(1).
+typedef struct {
+  double n; // number of points, or their total weight
+  double mean_x, mean_y;
+  double sxx, syy, sxy; // Σ(x-x̄)², Σ(y-ȳ)², Σ(x-x̄)(y-ȳ), weighted
+} line_stats;
+
+static inline void stats_reset(line_stats *s) {
+  *s = (line_stats){0};
+}
+
+// a point of weight w counts as w copies of it (West's weighted update)
+static inline void stats_add_weighted(line_stats *s, double x, double y,
+                                      double w) {
+  s->n += w;
+  double dx = x - s->mean_x, dy = y - s->mean_y;
+  s->mean_x += dx * w / s->n;
+  s->mean_y += dy * w / s->n;
+  s->sxx += w * dx * (x - s->mean_x);
+  s->syy += w * dy * (y - s->mean_y);
+  s->sxy += w * dx * (y - s->mean_y);
+}
+
+static inline void stats_add(line_stats *s, double x, double y) {
+  stats_add_weighted(s, x, y, 1);
+}
+
+static inline void stats_remove_weighted(line_stats *s, double x, double y,
+                                         double w) {
+  if (s->n <= w) {
+    stats_reset(s);
+    return;
+  }
+  // inverse of stats_add_weighted: recover the means without this point first
+  double dx = x - s->mean_x, dy = y - s->mean_y;
+  s->n -= w;
+  s->mean_x -= dx * w / s->n;
+  s->mean_y -= dy * w / s->n;
+  s->sxx -= w * (x - s->mean_x) * dx;
+  s->syy -= w * (y - s->mean_y) * dy;
+  s->sxy -= w * (x - s->mean_x) * dy;
+  if (s->sxx < 0)
+    s->sxx = 0;
+  if (s->syy < 0)
+    s->syy = 0;
+}
+
+static inline void stats_remove(line_stats *s, double x, double y) {
+  stats_remove_weighted(s, x, y, 1);
+}
+
+static inline void stats_move(line_stats *s, double old_x, double old_y,
+                              double x, double y, double w) {
+  stats_remove_weighted(s, old_x, old_y, w);
+  stats_add_weighted(s, x, y, w);
+}
+
+// Folds the statistics of another cloud into s, as if its points had been
+// added one by one (Chan et al. pairwise update).
+static inline void stats_merge(line_stats *s, const line_stats *o) {
+  if (o->n == 0)
+    return;
+  double n = s->n + o->n;
+  double dx = o->mean_x - s->mean_x, dy = o->mean_y - s->mean_y;
+  double w = s->n * o->n / n;
+  s->sxx += o->sxx + dx * dx * w;
+  s->syy += o->syy + dy * dy * w;
+  s->sxy += o->sxy + dx * dy * w;
+  s->mean_x += dx * o->n / n;
+  s->mean_y += dy * o->n / n;
+  s->n = n;
+}
+
+// Ordinary least squares slope and intercept, returns 0 when the fit is
+// undetermined (fewer than two distinct x values).
+static inline int stats_fit(const line_stats *s, double *gradient,
+                            double *intercept) {
+  if (s->n < 2 || s->sxx <= 0)
+    return 0;
+  *gradient = s->sxy / s->sxx;
+  *intercept = s->mean_y - *gradient * s->mean_x;
+  return 1;
+}
+
+// Mean squared error of y = gradient * x + intercept over the cloud.
+static inline double stats_mse(const line_stats *s, double gradient,
+                               double intercept) {
+  if (s->n == 0)
+    return 0;
+  double bias = gradient * s->mean_x + intercept - s->mean_y;
+  double spread = gradient * gradient * s->sxx - 2 * gradient * s->sxy + s->syy;
+  if (spread < 0)
+    spread = 0;
+  return spread / s->n + bias * bias;
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+// Streaming ingest: points from stdin, a FIFO or a growing log file.
+//
+// A reader thread parses CSV lines (the format of dataset.h) and pushes the
+// points into a single-producer single-consumer ring. loop() drains the ring
+// into user_points once a frame through stream_drain(), which never blocks.
+// The reader only ever touches the ring: user_points grows on the main
+// thread alone.
+//
+// The indices are free-running counters, head written by the reader and
+// tail by the drain, each on its own cache line, and each side caches the
+// other's so the shared lines only move when the ring looks full or empty.
+// The reader publishes head once per read() block, not per point.
+//
+// When the ring is full the reader either waits for the drain, which in
+// turn stalls the writer of a pipe (backpressure), or drops the point.
+// Both are counted, see stream_stats().
+
+#include "dataset.h"
+#include <stdint.h>
+
+#ifndef STREAM_RING
+// points, a power of two
+#define STREAM_RING (1 << 20)
+#endif
+#define STREAM_BUFFER (1 << 16)
+
+typedef struct {
+  unsigned long received; // points parsed by the reader
+  unsigned long dropped;  // of those, lost to a full ring
+  unsigned long stalls;   // times the reader waited on a full ring
+  unsigned long rejected; // lines that did not hold a point
+  unsigned long ingested; // points drained into user_points
+  size_t backlog;         // points waiting in the ring
+  int active, done;       // a stream was opened, it reached its end
+} stream_counters;
+
+#ifdef __ZIG_CC__
+
+// no threads on the web build
+int stream_open(const char *path, int follow, int drop) {
+  (void)path;
+  (void)follow;
+  (void)drop;
+  return 0;
+}
+long stream_drain() { return 0; }
+stream_counters stream_stats() { return (stream_counters){0}; }
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+typedef struct {
+  double x, y;
+} _stream_point;
+
+struct {
+  _Alignas(64) atomic_size_t head;
+  _Alignas(64) atomic_size_t tail;
+  _Alignas(64) _stream_point *ring;
+  char *buffer;
+  const char *path;
+  int follow, drop;
+  pthread_t thread;
+  int active, full_logged;
+  atomic_int done;
+  atomic_ulong received, dropped, stalls, rejected;
+  unsigned long ingested;
+} _stream;
+
+// the reader's side, private to its thread
+typedef struct {
+  size_t head, tail; // tail as last seen
+  unsigned long received, dropped, stalls, rejected;
+} _stream_writer;
+
+static void _stream_publish(_stream_writer *w) {
+  atomic_store_explicit(&_stream.head, w->head, memory_order_release);
+  atomic_store_explicit(&_stream.received, w->received, memory_order_relaxed);
+  atomic_store_explicit(&_stream.dropped, w->dropped, memory_order_relaxed);
+  atomic_store_explicit(&_stream.stalls, w->stalls, memory_order_relaxed);
+  atomic_store_explicit(&_stream.rejected, w->rejected, memory_order_relaxed);
+}
+
+static int _stream_full(_stream_writer *w) {
+  if (w->head - w->tail < STREAM_RING)
+    return 0;
+  w->tail = atomic_load_explicit(&_stream.tail, memory_order_acquire);
+  return w->head - w->tail == STREAM_RING;
+}
+
+// line is NUL terminated
+static void _stream_line(_stream_writer *w, const char *line) {
+  double x, y;
+  if (!_csv_pair(line, &x, &y)) {
+    w->rejected += line[strspn(line, " \t\r")] != 0;
+    return;
+  }
+  w->received++;
+  if (_stream_full(w)) {
+    if (_stream.drop) {
+      w->dropped++;
+      return;
+    }
+    // let the drain see what is there, then wait for room
+    _stream_publish(w);
+    w->stalls++;
+    while (_stream_full(w))
+      usleep(200);
+  }
+  _stream.ring[w->head & (STREAM_RING - 1)] = (_stream_point){x, y};
+  w->head++;
+}
+
+static void *_stream_reader(void *arg) {
+  (void)arg;
+  int fd = strcmp(_stream.path, "-") == 0 ? 0 : open(_stream.path, O_RDONLY);
+  _stream_writer w = {0};
+  char *buffer = _stream.buffer;
+  size_t held = 0; // bytes of an unfinished line at the start of buffer
+  while (fd >= 0) {
+    ssize_t got = read(fd, buffer + held, STREAM_BUFFER - 1 - held);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got == 0 && _stream.follow) {
+      // a log that may still grow, or a FIFO between writers
+      usleep(10000);
+      continue;
+    }
+    if (got <= 0)
+      break;
+    char *p = buffer, *end = buffer + held + got, *eol;
+    while ((eol = memchr(p, '\n', end - p)) != NULL) {
+      *eol = 0;
+      _stream_line(&w, p);
+      p = eol + 1;
+    }
+    held = end - p;
+    if (held == STREAM_BUFFER - 1) {
+      // no line is this long, skip it
+      w.rejected++;
+      held = 0;
+    }
+    memmove(buffer, p, held);
+    _stream_publish(&w);
+  }
+  if (held > 0) {
+    buffer[held] = 0;
+    _stream_line(&w, buffer);
+  }
+  _stream_publish(&w);
+  if (fd > 0)
+    close(fd);
+  atomic_store(&_stream.done, 1);
+  return NULL;
+}
+
+// Starts reading points from path, "-" for stdin. follow keeps polling at
+// the end of the input, for logs that grow; drop loses points when the ring
+// is full rather than holding the reader back. Returns 0 when a stream is
+// already open or the reader could not start.
+int stream_open(const char *path, int follow, int drop) {
+  if (_stream.active)
+    return 0;
+  _stream.ring = malloc(STREAM_RING * sizeof(_stream_point));
+  _stream.buffer = malloc(STREAM_BUFFER);
+  _stream.path = path;
+  _stream.follow = follow;
+  _stream.drop = drop;
+  if (_stream.ring == NULL || _stream.buffer == NULL ||
+      pthread_create(&_stream.thread, NULL, _stream_reader, NULL) != 0) {
+    free(_stream.ring);
+    free(_stream.buffer);
+    return 0;
+  }
+  pthread_detach(_stream.thread);
+  _stream.active = 1;
+  return 1;
+}
+
+// Moves every point the reader has parsed into user_points without ever
+// waiting on it. Returns how many, or -1 when the store could not grow, in
+// which case the points stay in the ring and the reader is held back.
+long stream_drain() {
+  if (!_stream.active)
+    return 0;
+  size_t tail = atomic_load_explicit(&_stream.tail, memory_order_relaxed);
+  size_t head = atomic_load_explicit(&_stream.head, memory_order_acquire);
+  size_t k = head - tail;
+  if (k == 0)
+    return 0;
+  // grow geometrically, a frame's worth of points at a time would copy the
+  // store every frame
+  while (user_points.n + k > user_points.capacity &&
+         _points_grow(&user_points))
+    ;
+  if (user_points.n + k > user_points.capacity) {
+    if (!_stream.full_logged)
+      lineup_log("Can not add any more points");
+    _stream.full_logged = 1;
+    return -1;
+  }
+  size_t first = user_points.n;
+  double *x = user_points.x + first, *y = user_points.y + first;
+  for (size_t j = 0; j < k; j++) {
+    _stream_point p = _stream.ring[(tail + j) & (STREAM_RING - 1)];
+    x[j] = p.x;
+    y[j] = p.y;
+  }
+  if (!points_commit(&user_points, k))
+    return -1;
+  atomic_store_explicit(&_stream.tail, head, memory_order_release);
+  for (size_t j = 0; j < k; j++)
+    stats_add(&user_stats, x[j], y[j]);
+  // the picking grid follows along, its rehashes amortized: dropping it
+  // would cost a rebuild over the whole store every frame of a busy feed
+  grid_insert_from(&user_grid, &user_points, first);
+  _stream.ingested += k;
+  points_version++;
+  return k;
+}
+
+stream_counters stream_stats() {
+  // done before head: once done is seen, head is final
+  int done = atomic_load(&_stream.done);
+  size_t head = atomic_load_explicit(&_stream.head, memory_order_acquire);
+  size_t tail = atomic_load_explicit(&_stream.tail, memory_order_relaxed);
+  return (stream_counters){
+      .received = atomic_load_explicit(&_stream.received, memory_order_relaxed),
+      .dropped = atomic_load_explicit(&_stream.dropped, memory_order_relaxed),
+      .stalls = atomic_load_explicit(&_stream.stalls, memory_order_relaxed),
+      .rejected = atomic_load_explicit(&_stream.rejected, memory_order_relaxed),
+      .ingested = _stream.ingested,
+      .backlog = head - tail,
+      .active = _stream.active,
+      .done = done && head == tail};
+}
+
+#endif
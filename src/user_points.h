@@ -1,54 +1,227 @@
 #pragma once
 
-#ifndef MAX_USER_POINTS
-#define MAX_USER_POINTS 50
-#endif
-
+#include "point_grid.h"
+#include "point_store.h"
+#include "stats.h"
 #include "utils.h"
-#include <gama.h>
 
-gmPos user_points[MAX_USER_POINTS];
-size_t n_user_points = 0;
-int selected_point = -1;
+point_store user_points = {0};
+line_stats user_stats = {0};
+// bumped on every edit, lets consumers notice the data changed
+unsigned long points_version = 0;
+// id of the selected point, so it survives other points being removed
+long selected_id = -1;
 
 const double point_radius = 0.04;
 
-void plot_user_points() {
-  for (size_t i = 0; i < n_user_points; i++) {
-    double x = user_points[i].x, y = user_points[i].y;
-    double radius = gm_anim_sin(point_radius, 0.001, 1, (double)i / 5);
-    gmColor color = selected_point == i ? GM_ORANGE : GM_REBECCAPURPLE;
-    gm_draw_circle(x, y, radius, gm_set_alpha(color, 200));
+// picking index, built on the first lookup so headless runs never pay for it
+point_grid user_grid = {0};
+
+// Panning and zooming change the view, not the data: points are drawn at
+// (data + view_offset) * view_zoom, through the gama camera of
+// view_camera(), and the mouse goes through to_data() before touching them.
+gmPos view_offset = {0, 0};
+double view_zoom = 1;
+
+#define VIEW_ZOOM_MIN 1e-3
+#define VIEW_ZOOM_MAX 1e5
+
+void move_points(gmPos pos) {
+  // the same speed on screen at any zoom
+  view_offset.x += pos.x / 100 / view_zoom;
+  view_offset.y += pos.y / 100 / view_zoom;
+}
+
+// zooms around the center of the screen
+void zoom_view(double factor) {
+  view_zoom *= factor;
+  if (view_zoom < VIEW_ZOOM_MIN)
+    view_zoom = VIEW_ZOOM_MIN;
+  if (view_zoom > VIEW_ZOOM_MAX)
+    view_zoom = VIEW_ZOOM_MAX;
+}
+
+static inline gmPos to_data(gmPos view) {
+  return (gmPos){view.x / view_zoom - view_offset.x,
+                 view.y / view_zoom - view_offset.y};
+}
+
+void move_user_point(size_t i, gmPos pos) {
+  stats_move(&user_stats, user_points.x[i], user_points.y[i], pos.x, pos.y,
+             points_weight(&user_points, i));
+  grid_remove(&user_grid, &user_points, i);
+  user_points.x[i] = pos.x;
+  user_points.y[i] = pos.y;
+  grid_insert(&user_grid, &user_points, i);
+  points_version++;
+}
+
+void select_point(size_t i) { selected_id = points_id(&user_points, i); }
+void unselect_point() { selected_id = -1; }
+
+// index of the selected point, -1 if there is none
+static inline long selected_point() {
+  if (selected_id < 0)
+    return -1;
+  uint32_t i = points_index(&user_points, selected_id);
+  return i == POINT_NONE ? -1 : (long)i;
+}
+
+// returns 0 when the point store is out of memory
+int add_user_point(double x, double y) {
+  if (!points_push(&user_points, x, y)) {
+    lineup_log("Can not add any more points");
+    return 0;
   }
+  stats_add(&user_stats, x, y);
+  grid_insert(&user_grid, &user_points, user_points.n - 1);
+  points_version++;
+  return 1;
 }
-void move_points(gmPos pos) {
-  for (size_t i = 0; i < n_user_points; i++) {
-    user_points[i].x += pos.x / 100;
-    user_points[i].y += pos.y / 100;
+
+// puts a deleted point back under its id, 0 when that is not possible
+int revive_user_point(uint32_t id, double x, double y, double w) {
+  if (!points_revive(&user_points, id, x, y, w))
+    return 0;
+  stats_add_weighted(&user_stats, x, y, w);
+  grid_insert(&user_grid, &user_points, user_points.n - 1);
+  points_version++;
+  return 1;
+}
+
+// O(1): the last point moves into the hole, ids keep naming the same points
+int delete_user_point(size_t i) {
+  double x = user_points.x[i], y = user_points.y[i];
+  double w = points_weight(&user_points, i);
+  size_t last = user_points.n - 1;
+  grid_remove(&user_grid, &user_points, i);
+  if (i != last)
+    grid_remove(&user_grid, &user_points, last);
+  if (!points_swap_remove(&user_points, i)) {
+    // out of memory for the id tables, nothing was removed
+    grid_free(&user_grid);
+    lineup_log("Can not delete points");
+    return 0;
   }
+  if (i != last)
+    grid_insert(&user_grid, &user_points, i);
+  stats_remove_weighted(&user_stats, x, y, w);
+  points_version++;
+  return 1;
 }
 
-void select_point(int id) { selected_point = id; }
-void unselect_point() { selected_point = -1; }
+// deletes the points with these ids in O(k), skipping ids already gone
+void delete_user_points(const uint32_t *ids, size_t k) {
+  for (size_t j = 0; j < k; j++) {
+    uint32_t i = points_index(&user_points, ids[j]);
+    if (i != POINT_NONE && !delete_user_point(i))
+      return;
+  }
+}
 
-void add_user_point(double x, double y) {
-  if (n_user_points + 1 >= MAX_USER_POINTS) {
-    gm_log("Can not add any more points");
+void delete_selected_point() {
+  long i = selected_point();
+  if (i < 0)
     return;
+  delete_user_point(i);
+  unselect_point();
+}
+
+#ifndef LINEUP_HEADLESS
+
+static inline gmCamera view_camera() {
+  return (gmCamera){-view_offset.x, -view_offset.y, view_zoom};
+}
+
+// circles per batch call, the buffer lives on the stack
+#define PLOT_BATCH 512
+
+// points pulse in PLOT_PHASES groups, by id
+#define PLOT_PHASES 5
+
+typedef struct {
+  float xyr[3 * PLOT_BATCH];
+  size_t k;
+  long selected;
+  double radius[PLOT_PHASES];
+  gmColor color;
+} _plot_batch;
+
+// the pulsing radius of the points of a phase group. gama's sin() reduces
+// its argument 2 pi at a time, so the whole seconds of gm_t() are taken out
+// first, and it runs once per group, not per point
+static double _plot_radius(double radius, long phase) {
+  return gm_anim_sin(radius, 0.001 / view_zoom, 1,
+                     (double)phase / PLOT_PHASES - (long)gm_t());
+}
+
+static int _plot_point(size_t i, void *ctx) {
+  _plot_batch *b = ctx;
+  if ((long)i == b->selected)
+    return 1;
+  // phase from the id, a point keeps its pulse when others are deleted
+  long phase = points_id(&user_points, i) % PLOT_PHASES;
+  b->xyr[3 * b->k] = user_points.x[i];
+  b->xyr[3 * b->k + 1] = user_points.y[i];
+  b->xyr[3 * b->k + 2] = b->radius[phase];
+  if (++b->k == PLOT_BATCH) {
+    gm_draw_circles_batch(b->xyr, b->k, b->color);
+    b->k = 0;
+  }
+  return 1;
+}
+
+// the visible points, under view_camera()
+void plot_user_points() {
+  // points keep their size on screen at any zoom
+  double radius = point_radius / view_zoom;
+  double x0, y0, x1, y1;
+  gm_camera_bounds(&x0, &y0, &x1, &y1);
+  _plot_batch b = {.selected = selected_point(),
+                   .color = gm_set_alpha(GM_REBECCAPURPLE, 200)};
+  for (long phase = 0; phase < PLOT_PHASES; phase++)
+    b.radius[phase] = _plot_radius(radius, phase);
+  grid_visit(&user_grid, &user_points, x0 - radius, y0 - radius, x1 + radius,
+             y1 + radius, _plot_point, &b);
+  if (b.k > 0)
+    gm_draw_circles_batch(b.xyr, b.k, b.color);
+  // on top of the others
+  if (b.selected >= 0) {
+    gm_draw_circle(user_points.x[b.selected], user_points.y[b.selected],
+                   b.radius[selected_id % PLOT_PHASES],
+                   gm_set_alpha(GM_ORANGE, 200));
   }
-  user_points[n_user_points].x = x;
-  user_points[n_user_points].y = y;
-  n_user_points++;
 }
 
 void find_selected_point() {
-  if (selected_point != -1 && selected_point < n_user_points)
-    if (gm_pos_distance(gm_mouse.position, user_points[selected_point]) <
-        point_radius * 2)
+  gmPos mouse = to_data(gm_mouse.position);
+  double mx = mouse.x, my = mouse.y;
+  // as drawn, but within the grid's reach when zoomed far out
+  double radius = point_radius / view_zoom;
+  if (radius > 2 * point_radius)
+    radius = 2 * point_radius;
+  long selected = selected_point();
+  if (selected >= 0) {
+    double dx = user_points.x[selected] - mx;
+    double dy = user_points.y[selected] - my;
+    if (dx * dx + dy * dy < 4 * radius * radius)
       return;
+  }
 
-  for (size_t i = 0; i < n_user_points; i++) {
-    if (gm_pos_distance(gm_mouse.position, user_points[i]) < point_radius) {
+  if (!user_grid.built)
+    grid_build(&user_grid, &user_points, 2 * point_radius);
+  if (user_grid.built) {
+    long found = grid_find(&user_grid, &user_points, mx, my, radius);
+    if (found >= 0)
+      select_point(found);
+    else
+      unselect_point();
+    return;
+  }
+  // no memory for the grid, scan
+  for (size_t i = 0; i < user_points.n; i++) {
+    double dx = user_points.x[i] - mx, dy = user_points.y[i] - my;
+    if (dx * dx + dy * dy < radius * radius) {
       select_point(i);
       return;
     }
@@ -56,18 +229,12 @@ void find_selected_point() {
   unselect_point();
 }
 
-void delete_selected_point() {
-  if (selected_point < 0)
-    return;
-  for (size_t i = selected_point; i < n_user_points - 1; i++)
-    user_points[i] = user_points[i + 1];
-  n_user_points--;
-  unselect_point();
-}
-
 void show_selected_point_position() {
-  if (selected_point < 0)
+  long selected = selected_point();
+  if (selected < 0)
     return;
-  double x = user_points[selected_point].x, y = user_points[selected_point].y;
-  show_position(x, y, GM_GREENYELLOW);
+  show_position(user_points.x[selected], user_points.y[selected],
+                GM_GREENYELLOW);
 }
+
+#endif
@@ -1,8 +1,33 @@
 #pragma once
+
+#ifdef LINEUP_HEADLESS
+
+// engine only build: no window, no gapi
+#include <gama/position.h>
+#include <stdint.h>
+#include <stdio.h>
+
+void lineup_log(const char *msg) { fprintf(stderr, "%s\n", msg); }
+
+#else
+
 #include <gama.h>
 
+void lineup_log(const char *msg) { gm_log(msg); }
+
 void show_position(double x, double y, gmColor color) {
   char label_txt[50] = {0};
   snprintf(label_txt, sizeof(label_txt), "(%.2lf,%.2lf)", x, y);
   gm_draw_text(x, y, label_txt, "", 0.08, color);
 }
+
+// 1 only on the frame the key goes down, gm_key() stays 1 while held
+int key_pressed(char key) {
+  static uint8_t was_down[256] = {0};
+  int down = gm_key(key);
+  int pressed = down && !was_down[(uint8_t)key];
+  was_down[(uint8_t)key] = down;
+  return pressed;
+}
+
+#endif
@@ -0,0 +1,99 @@
+// Benchmarks the training paths of src/line.h over growing point counts.
+//
+//   cc -O2 -march=native -Iinclude tools/bench.c -lm -lpthread -o bench
+//   ./bench [max_n] [threads]
+//
+// n sweeps 10, 100, ... up to max_n, at most BENCH_MAX_N (default 1e8, 1.6GB
+// of points). Each path gets warmup runs, then repetitions until ~0.2s have
+// passed, and the best repetition is reported. GB/s counts the bytes of points read.
+
+#define LINEUP_HEADLESS
+
+#ifndef BENCH_MAX_N
+#define BENCH_MAX_N 100000000
+#endif
+
+#include "../src/generate.h"
+#include "../src/line.h"
+#include "../src/schedule.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_WARMUP 2
+#define BENCH_MIN_SECONDS 0.2
+
+typedef struct {
+  const char *name;
+  void (*run)();
+} bench_path;
+
+static void run_sgd() {
+  training = TRAIN_SGD;
+  one_epoch();
+}
+static void run_batch() {
+  training = TRAIN_BATCH;
+  one_epoch();
+}
+static void run_minibatch() {
+  training = TRAIN_MINIBATCH;
+  one_epoch();
+}
+static void run_loss() {
+  invalidate_loss();
+  find_loss();
+}
+static void run_exact() { fit_exact(); }
+
+static const bench_path paths[] = {
+    {"sgd", run_sgd},     {"batch", run_batch}, {"minibatch", run_minibatch},
+    {"loss", run_loss},   {"exact", run_exact},
+};
+
+// grows the cloud to n points around y = 0.7x - 0.3
+static void bench_fill(size_t n) {
+  generator g = default_generator;
+  g.noise = NOISE_UNIFORM;
+  g.seed = n;
+  if (generate_points(&g, n - user_points.n) < 0) {
+    fprintf(stderr, "could not allocate %zu points\n", n);
+    exit(1);
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t max_n = argc > 1 ? strtoull(argv[1], NULL, 10) : BENCH_MAX_N;
+  if (max_n > BENCH_MAX_N)
+    max_n = BENCH_MAX_N;
+  pool_set_threads(argc > 2 ? strtoul(argv[2], NULL, 10) : 0);
+  // keep the parameters bounded over long runs
+  learn_rate = 1e-6;
+
+  printf("threads: %zu\n", pool_threads);
+  printf("%-10s %12s %10s %12s %10s %14s\n", "path", "n", "reps",
+         "ns/point", "GB/s", "epochs/s");
+  for (size_t n = 10; n <= max_n; n *= 10) {
+    bench_fill(n);
+    for (size_t k = 0; k < sizeof(paths) / sizeof(paths[0]); k++) {
+      gradient = intercept = 0;
+      for (int w = 0; w < BENCH_WARMUP; w++)
+        paths[k].run();
+      double best = -1, total = 0;
+      unsigned long reps = 0;
+      while (total < BENCH_MIN_SECONDS || reps < 3) {
+        double start = now_seconds();
+        paths[k].run();
+        double t = now_seconds() - start;
+        total += t;
+        reps++;
+        if (best < 0 || t < best)
+          best = t;
+      }
+      // exact is O(1), the per-point figures are not meaningful for it
+      double bytes = paths[k].run == run_exact ? 0 : (double)n * 2 * sizeof(double);
+      printf("%-10s %12zu %10lu %12.3f %10.2f %14.1f\n", paths[k].name, n,
+             reps, best * 1e9 / n, bytes / best / 1e9, 1 / best);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,258 @@
+// Headless checks of the regression engine, and of gama's draw caches on
+// the stub backend: exits 1, naming the failing check, when one fails.
+//
+//   cc -O2 -march=native -Iinclude tools/check.c -lm -lpthread -o check
+//   ./check
+
+#define LINEUP_HEADLESS
+
+#include "../src/convergence.h"
+#include "../src/dataset.h"
+#include "../src/generate.h"
+#include "../src/journal.h"
+#include <gama/draw.h>
+#include <gama/gapi_stub.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define CHECK_MAX_EPOCHS 200000
+
+static int failures = 0;
+
+static void check(int ok, const char *what) {
+  printf("%s: %s\n", ok ? "ok" : "FAILED", what);
+  failures += !ok;
+}
+
+static void reset_fit() {
+  gradient = intercept = 0;
+  optimizer_reset(&opt);
+  invalidate_loss();
+  watch_convergence();
+}
+
+// trains as autoplay does until converged, returns the epochs it took or 0
+static unsigned long train_until_converged() {
+  for (unsigned long epoch = 1; epoch <= CHECK_MAX_EPOCHS; epoch++) {
+    one_epoch();
+    find_loss();
+    check_convergence();
+    if (converged)
+      return epoch;
+  }
+  return 0;
+}
+
+// the subgradient of L1 never vanishes, autoplay must still idle
+static void check_l1_batch_converges() {
+  loss_type = LOSS_L1;
+  training = TRAIN_BATCH;
+  reset_fit();
+  unsigned long epochs = train_until_converged();
+  check(epochs > 0, "l1 batch training converges");
+  double settled = loss;
+  for (int i = 0; i < 1000; i++)
+    one_epoch();
+  find_loss();
+  check(epochs > 0 && settled <= loss * (1 + 1e-6),
+        "l1 batch training converges at the optimum");
+}
+
+static void check_l2_batch_converges() {
+  loss_type = LOSS_L2;
+  training = TRAIN_BATCH;
+  learn_rate = 0.1;
+  reset_fit();
+  check(train_until_converged() > 0, "l2 batch training converges");
+  double trained[2] = {gradient, intercept};
+  fit_exact();
+  check(fabs(trained[0] - gradient) < 1e-3 &&
+            fabs(trained[1] - intercept) < 1e-3,
+        "l2 batch training converges to the exact fit");
+  learn_rate = 0.01;
+}
+
+// the last batch is short, 10000 % 32 points: the epoch's pooled gradient
+// never vanishes, the line still settles near the exact fit
+static void check_minibatch_converges() {
+  loss_type = LOSS_L2;
+  training = TRAIN_MINIBATCH;
+  batch_size = 32;
+  reset_fit();
+  check(user_points.n % batch_size != 0 && train_until_converged() > 0,
+        "mini-batch training converges with a short last batch");
+  double trained[2] = {gradient, intercept};
+  fit_exact();
+  check(fabs(trained[0] - gradient) < 1e-2 &&
+            fabs(trained[1] - intercept) < 1e-2,
+        "mini-batch training settles near the exact fit");
+}
+
+// momentum gathered on one problem must not carry over to the next
+static void check_optimizer_resets() {
+  set_optimizer(OPT_ADAM);
+  reset_fit();
+  for (int i = 0; i < 10; i++)
+    one_epoch();
+  points_version++;
+  watch_convergence();
+  optimizer fresh = optimizer_create(OPT_ADAM);
+  check(opt.v[0] == 0 && opt.v[1] == 0 && opt.s[0] == 0 && opt.s[1] == 0 &&
+            opt.beta1_t == fresh.beta1_t,
+        "optimizer state resets when the points change");
+  set_optimizer(LINEUP_OPTIMIZER);
+}
+
+static void check_generator_counts() {
+  generator g = default_generator;
+  check(generator_parse(&g, "n=1e6,clusters=3") == 1000000 && g.clusters == 3,
+        "generator spec reads counts");
+  check(generator_parse(&g, "n=-1") < 0 && generator_parse(&g, "n=2.5") < 0 &&
+            generator_parse(&g, "n=4294967295") < 0 &&
+            generator_parse(&g, "n=1e300") < 0 &&
+            generator_parse(&g, "n=nan") < 0 &&
+            generator_parse(&g, "clusters=-3") < 0,
+        "generator spec rejects counts a store cannot hold");
+}
+
+// ids and weights cost nothing until a point is removed or weighted, and
+// keep naming the same points after
+static void check_point_store_columns() {
+  point_store s = {0};
+  for (int i = 0; i < 3; i++)
+    points_push(&s, i, 10 * i);
+  check(s.id == NULL && s.index_of == NULL && s.w == NULL &&
+            points_id(&s, 2) == 2 && points_weight(&s, 2) == 1,
+        "point store allocates no id or weight column up front");
+  points_swap_remove(&s, 0);
+  check(s.n == 2 && points_index(&s, 0) == POINT_NONE &&
+            points_index(&s, 2) == 0 && s.x[0] == 2 && s.w == NULL,
+        "a removed point's id is gone, the moved one keeps its own");
+  check(points_revive(&s, 0, 0, 0, 2.5) && points_index(&s, 0) == 2 &&
+            points_weight(&s, 2) == 2.5 && points_weight(&s, 0) == 1,
+        "a revived point comes back under its id with its weight");
+  points_free(&s);
+}
+
+// a whole drag is one record, and undo then redo restores the points and
+// the statistics the exact fit reads
+static void check_journal() {
+  journal_clear();
+  size_t n = user_points.n;
+  line_stats before = user_stats;
+  journal_add_point(5, 5);
+  journal_seal();
+  journal_move_point(n, (gmPos){6, 6});
+  journal_move_point(n, (gmPos){7, 7});
+  journal_seal();
+  journal_delete_point(n);
+  check(journal.count == 3, "journal coalesces a drag into one record");
+  undo_edit();
+  undo_edit();
+  check(user_points.n == n + 1 && user_points.x[n] == 5 &&
+            user_points.y[n] == 5,
+        "undo restores a point deleted after a drag, then undoes the drag");
+  undo_edit();
+  check(user_points.n == n && !undo_edit() && user_stats.n == before.n &&
+            fabs(user_stats.mean_x - before.mean_x) < 1e-12 &&
+            fabs(user_stats.sxy - before.sxy) < 1e-9 * fabs(before.sxy),
+        "undoing every edit restores the points and their statistics");
+  redo_edit();
+  redo_edit();
+  check(user_points.n == n + 1 && user_points.x[n] == 7 && redo_edit() &&
+            user_points.n == n && !redo_edit(),
+        "redo replays the edits in order");
+  journal_clear();
+}
+
+// replaces user_points with the file's, the number loaded or -1
+static long reload_points(const char *path) {
+  points_free(&user_points);
+  stats_reset(&user_stats);
+  return load_points_lup(path);
+}
+
+// user_points saved as .lup load back as they were, float64 mapped and
+// float32 rounded; a header whose stats do not match is refused. Last, it
+// replaces the points.
+static void check_lup_round_trip() {
+  size_t n = user_points.n;
+  double *x = malloc(2 * n * sizeof(double)), *y = x + n;
+  char f64[] = "/tmp/lineup_checkXXXXXX", f32[] = "/tmp/lineup_checkXXXXXX";
+  int fd64 = mkstemp(f64), fd32 = mkstemp(f32);
+  close(fd64);
+  close(fd32);
+  int saved = x != NULL && fd64 >= 0 && fd32 >= 0 &&
+              save_points_lup(f64, POINTS_F64) &&
+              save_points_lup(f32, POINTS_F32);
+  check(saved, "points save as .lup");
+  if (saved) {
+    memcpy(x, user_points.x, n * sizeof(double));
+    memcpy(y, user_points.y, n * sizeof(double));
+    int same = reload_points(f64) == (long)n && user_stats.n == n;
+#ifdef POINT_STORE_MMAP
+    same = same && user_points._mapped != 0;
+#endif
+    for (size_t i = 0; same && i < n; i++)
+      same = user_points.x[i] == x[i] && user_points.y[i] == y[i];
+    check(same, "float64 .lup loads back the same points");
+    same = reload_points(f32) == (long)n && user_stats.n == n;
+    for (size_t i = 0; same && i < n; i++)
+      same = user_points.x[i] == (float)x[i] && user_points.y[i] == (float)y[i];
+    check(same, "float32 .lup loads back the points rounded to float");
+    FILE *f = fopen(f64, "r+b");
+    double mean = 0;
+    long at = offsetof(points_header, stats) + offsetof(line_stats, mean_y);
+    if (f && fseek(f, at, SEEK_SET) == 0 && fread(&mean, sizeof(mean), 1, f)) {
+      mean += 0.01;
+      fseek(f, at, SEEK_SET);
+      fwrite(&mean, sizeof(mean), 1, f);
+    }
+    if (f)
+      fclose(f);
+    check(reload_points(f64) < 0, ".lup with stale stats is refused");
+  }
+  remove(f64);
+  remove(f32);
+  free(x);
+}
+
+// two labels in the same set of the text run cache, both drawn every frame,
+// must not evict each other before they are promoted to runs
+static void check_text_run_collisions() {
+  const size_t sets = GM_TEXT_RUNS / 2;
+  char a[] = "label 0", b[32];
+  uint64_t set = _gm_text_hash(a, "", 0.05, 0) & (sets - 1);
+  for (int i = 1;; i++) {
+    snprintf(b, sizeof(b), "label %d", i);
+    if ((_gm_text_hash(b, "", 0.05, 0) & (sets - 1)) == set)
+      break;
+  }
+  int runs = 0;
+  for (int frame = 0; frame < 3; frame++)
+    runs = (_gm_text_run(a, "", 0.05, 0) != 0) +
+           (_gm_text_run(b, "", 0.05, 0) != 0);
+  check(runs == 2, "colliding labels both get text runs");
+}
+
+int main() {
+  pool_set_threads(0);
+  generator g = default_generator;
+  g.seed = 3;
+  if (generate_points(&g, 10000) < 0) {
+    fprintf(stderr, "could not allocate the points\n");
+    return 1;
+  }
+  check_l1_batch_converges();
+  check_l2_batch_converges();
+  check_minibatch_converges();
+  check_optimizer_resets();
+  check_generator_counts();
+  check_point_store_columns();
+  check_journal();
+  check_text_run_collisions();
+  check_lup_round_trip();
+  return failures > 0;
+}
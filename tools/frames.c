@@ -0,0 +1,122 @@
+// Headless frame benchmark: runs the app itself, setup() then loop() for N
+// frames, on the stub backend of include/gama/gapi_stub.h. No window or GPU
+// is involved; scripted input is replayed, and the time per frame and the
+// draw commands issued are printed.
+//
+//   cc -O2 -march=native -Iinclude tools/frames.c -lm -lpthread -o frames
+//   ./frames -n 600 -s input.txt
+//   LINEUP_GENERATE=n=1e6 ./frames -n 300 -d frames.log
+//
+// The app reads its usual LINEUP_* variables. frame_ms is wall time from one
+// frame to the next on the main thread; cpu_ms_per_frame counts every
+// thread, the workers of the pool included. Draw counts are per frame,
+// averaged over the run.
+
+// the app in GM_SETUP mode, without GM_NATIVE: main() is this file's
+#include "../src/main.c"
+#include <gama/gapi_stub.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  -n N   frames to run (default 300)\n"
+          "  -s F   replay the input script F, see gapi_stub_script()\n"
+          "  -w WxH window size in pixels (default the app's)\n"
+          "  -d F   append every frame's command log to F\n",
+          name);
+}
+
+int main(int argc, char **argv) {
+  long frames = 300;
+  const char *script = NULL, *dump = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    int ok = 1;
+    if (strcmp(arg, "-n") == 0 && value)
+      ok = (frames = strtol(argv[++i], NULL, 10)) > 0;
+    else if (strcmp(arg, "-s") == 0 && value)
+      script = argv[++i];
+    else if (strcmp(arg, "-w") == 0 && value) {
+      int width, height;
+      ok = sscanf(argv[++i], "%dx%d", &width, &height) == 2 && width > 0 &&
+           height > 0;
+      if (ok)
+        gapi_stub_window(width, height);
+    } else if (strcmp(arg, "-d") == 0 && value)
+      dump = argv[++i];
+    else
+      ok = 0;
+    if (!ok) {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (script && gapi_stub_script(script) < 0) {
+    fprintf(stderr, "could not read the script %s\n", script);
+    return 1;
+  }
+  FILE *log = NULL;
+  if (dump && (log = fopen(dump, "wb")) == NULL) {
+    fprintf(stderr, "could not open %s\n", dump);
+    return 1;
+  }
+  gapi_stub_frames(frames);
+
+  int code = setup();
+  if (code != 0)
+    return code;
+  while (_gm_loop()) {
+    if ((code = loop()) != 0)
+      break;
+    if (log) {
+      size_t size;
+      const uint8_t *commands = gapi_stub_log(&size);
+      fwrite(commands, 1, size, log);
+    }
+  }
+  if (log)
+    fclose(log);
+
+  long ran = gapi_stub.frames;
+  if (ran == 0) {
+    fprintf(stderr, "no frame ran\n");
+    return 1;
+  }
+  double total = 0;
+  long timed = ran < GAPI_STUB_MAX_FRAMES ? ran : GAPI_STUB_MAX_FRAMES;
+  for (long i = 0; i < timed; i++)
+    total += gapi_stub.times[i];
+  printf("frames: %ld\n", ran);
+  printf("setup_ms: %.3f\n", gapi_stub.setup_ms);
+  printf("frame_ms_mean: %.4f\n", total / timed);
+  printf("frame_ms_min: %.4f\n", gapi_stub_frame_ms(0));
+  printf("frame_ms_p50: %.4f\n", gapi_stub_frame_ms(0.5));
+  printf("frame_ms_p99: %.4f\n", gapi_stub_frame_ms(0.99));
+  printf("frame_ms_max: %.4f\n", gapi_stub_frame_ms(1));
+  printf("cpu_ms_per_frame: %.4f\n", gapi_stub.cpu_ms / ran);
+
+  gapiStubTally sum = {0};
+  for (int op = 0; op < GAPI_STUB_OPS; op++) {
+    const gapiStubTally *t = &gapi_stub.tally[op];
+    if (t->calls == 0)
+      continue;
+    printf("%s: %.2f calls, %.1f primitives, %.0f bytes\n",
+           gapi_stub_op_names[op], (double)t->calls / ran,
+           (double)t->primitives / ran, (double)t->bytes / ran);
+    sum.calls += t->calls;
+    sum.primitives += t->primitives;
+    sum.bytes += t->bytes;
+  }
+  printf("draw_calls_per_frame: %.1f\n", (double)sum.calls / ran);
+  printf("primitives_per_frame: %.1f\n", (double)sum.primitives / ran);
+  printf("log_bytes_per_frame: %.0f\n", (double)sum.bytes / ran);
+  printf("text_runs_alive: %ld\n", gapi_stub.text_runs);
+  if (gapi_stub.overflows > 0)
+    printf("log_overflows: %ld\n", gapi_stub.overflows);
+  return code;
+}
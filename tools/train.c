@@ -0,0 +1,227 @@
+// Headless trainer: runs the regression engine from src/ on a point file,
+// without a window or any gapi call, and prints the fit and throughput.
+//
+//   cc -O2 -march=native -Iinclude tools/train.c -lm -lpthread -o train
+//   ./train -m batch -o adam -l 0.1 -e 5000 points.csv
+//   ./train -w points.lup points.csv    (convert once, then train on .lup)
+//   ./train -g n=1e8,noise=cauchy,seed=7 -m batch -e 10
+
+#define LINEUP_HEADLESS
+
+#include "../src/compact.h"
+#include "../src/convergence.h"
+#include "../src/dataset.h"
+#include "../src/generate.h"
+#include "../src/line.h"
+#include "../src/schedule.h"
+#include "../src/stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [options] <points.csv|points.bin|points.lup>\n"
+          "       %s [options] -g <spec>\n"
+          "  -e N   epochs to run (default 1000)\n"
+          "  -s S   stop after S seconds instead\n"
+          "  -c     stop early once converged\n"
+          "  -m M   training: stochastic, batch or minibatch\n"
+          "  -b N   mini-batch size\n"
+          "  -o O   optimizer: sgd, momentum, nesterov, rmsprop or adam\n"
+          "  -l R   learn rate (default 0.01)\n"
+          "  -L L   loss: l1, l2 (default) or huber\n"
+          "  -d D   huber delta (default 0.1)\n"
+          "  -j N   threads, 0 for one per core (default)\n"
+          "  -x     closed-form least squares instead of training\n"
+          "  -f     stream the input through the ingest ring, - for stdin\n"
+          "  -q T   merge points closer than T into weighted points first\n"
+          "  -w F   write the points to F in the .lup format and exit\n"
+          "  -t T   column type for -w: f64 (default) or f32\n"
+          "  -g G   generate points instead of reading a file, G is a spec\n"
+          "         like n=1e6,slope=0.7,intercept=-0.3,noise=normal,\n"
+          "         scale=0.1,outliers=0,range=2,clusters=0,spread=0.1,seed=1\n",
+          name, name);
+}
+
+static int parse_training(const char *name) {
+  if (strcmp(name, "stochastic") == 0 || strcmp(name, "sgd") == 0)
+    training = TRAIN_SGD;
+  else if (strcmp(name, "batch") == 0)
+    training = TRAIN_BATCH;
+  else if (strcmp(name, "minibatch") == 0 || strcmp(name, "mini-batch") == 0)
+    training = TRAIN_MINIBATCH;
+  else
+    return 0;
+  return 1;
+}
+
+static int parse_optimizer(const char *name) {
+  for (int kind = 0; kind < OPTIMIZER_COUNT; kind++)
+    if (strcmp(name, optimizer_name(kind)) == 0) {
+      set_optimizer(kind);
+      return 1;
+    }
+  return 0;
+}
+
+static int parse_loss(const char *name) {
+  for (int kind = 0; kind < LOSS_COUNT; kind++)
+    if (strcmp(name, loss_name(kind)) == 0) {
+      loss_type = kind;
+      return 1;
+    }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  unsigned long epochs = 1000;
+  double seconds = 0, tolerance = 0;
+  int until_converged = 0, streamed = 0;
+  const char *path = NULL, *convert = NULL, *generate = NULL;
+  points_dtype dtype = POINTS_F64;
+  pool_set_threads(0);
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    int ok = 1;
+    if (strcmp(arg, "-e") == 0 && value)
+      epochs = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(arg, "-s") == 0 && value)
+      seconds = strtod(argv[++i], NULL);
+    else if (strcmp(arg, "-c") == 0)
+      until_converged = 1;
+    else if (strcmp(arg, "-m") == 0 && value)
+      ok = parse_training(argv[++i]);
+    else if (strcmp(arg, "-b") == 0 && value)
+      batch_size = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(arg, "-o") == 0 && value)
+      ok = parse_optimizer(argv[++i]);
+    else if (strcmp(arg, "-l") == 0 && value)
+      learn_rate = strtod(argv[++i], NULL);
+    else if (strcmp(arg, "-L") == 0 && value)
+      ok = parse_loss(argv[++i]);
+    else if (strcmp(arg, "-d") == 0 && value)
+      huber_delta = strtod(argv[++i], NULL);
+    else if (strcmp(arg, "-j") == 0 && value)
+      pool_set_threads(strtoul(argv[++i], NULL, 10));
+    else if (strcmp(arg, "-x") == 0)
+      exact_fit = 1;
+    else if (strcmp(arg, "-f") == 0)
+      streamed = 1;
+    else if (strcmp(arg, "-q") == 0 && value)
+      tolerance = strtod(argv[++i], NULL);
+    else if (strcmp(arg, "-g") == 0 && value)
+      generate = argv[++i];
+    else if (strcmp(arg, "-w") == 0 && value)
+      convert = argv[++i];
+    else if (strcmp(arg, "-t") == 0 && value) {
+      const char *type = argv[++i];
+      dtype = strcmp(type, "f32") == 0 ? POINTS_F32 : POINTS_F64;
+      ok = dtype == POINTS_F32 || strcmp(type, "f64") == 0;
+    }
+    else if ((arg[0] != '-' || strcmp(arg, "-") == 0) && path == NULL)
+      path = arg;
+    else
+      ok = 0;
+    if (!ok) {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if ((path == NULL) == (generate == NULL)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  double load_start = now_seconds();
+  if (generate) {
+    generator g = default_generator;
+    long n = generator_parse(&g, generate);
+    if (n < 0) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (generate_points(&g, n) < 0) {
+      fprintf(stderr, "could not allocate %ld points\n", n);
+      return 1;
+    }
+  } else if (streamed) {
+    if (!stream_open(path, 0, 0)) {
+      fprintf(stderr, "could not stream %s\n", path);
+      return 1;
+    }
+    stream_counters feed;
+    while (!(feed = stream_stats()).done)
+      if (stream_drain() == 0)
+        usleep(100);
+    printf("stream_received: %lu\n", feed.received);
+    printf("stream_rejected: %lu\n", feed.rejected);
+    printf("stream_stalls: %lu\n", feed.stalls);
+    printf("stream_points_per_second: %.0f\n",
+           feed.ingested / (now_seconds() - load_start));
+  } else if (load_points(path) < 0) {
+    fprintf(stderr, "could not open %s\n", path);
+    return 1;
+  }
+  double load_time = now_seconds() - load_start;
+
+  size_t loaded = user_points.n;
+  if (tolerance > 0) {
+    double compact_start = now_seconds();
+    if (compact_user_points(tolerance) < 0) {
+      fprintf(stderr, "could not compact %zu points\n", loaded);
+      return 1;
+    }
+    printf("loaded_points: %zu\n", loaded);
+    printf("compact_seconds: %.6f\n", now_seconds() - compact_start);
+  }
+
+  if (convert) {
+    double save_start = now_seconds();
+    if (!save_points_lup(convert, dtype)) {
+      fprintf(stderr, "could not write %s%s\n", convert,
+              user_points.w ? ", weighted points have no .lup form" : "");
+      return 1;
+    }
+    printf("points: %zu\n", user_points.n);
+    printf("load_seconds: %.6f\n", load_time);
+    printf("save_seconds: %.6f\n", now_seconds() - save_start);
+    return 0;
+  }
+
+  unsigned long ran = 0;
+  double start = now_seconds(), elapsed = 0;
+  if (exact_fit) {
+    fit_exact();
+  } else {
+    watch_convergence();
+    while (seconds > 0 ? elapsed < seconds : ran < epochs) {
+      one_epoch();
+      ran++;
+      if (until_converged) {
+        // mini-batch and stochastic epochs leave the loss stale
+        find_loss();
+        check_convergence();
+        if (converged)
+          break;
+      }
+      elapsed = now_seconds() - start;
+    }
+    find_loss();
+  }
+  elapsed = now_seconds() - start;
+
+  printf("points: %zu\n", user_points.n);
+  printf("load_seconds: %.6f\n", load_time);
+  printf("gradient: %.17g\n", gradient);
+  printf("intercept: %.17g\n", intercept);
+  printf("loss: %s\n", loss_name(minimized_loss()));
+  printf("loss_value: %.17g\n", loss);
+  printf("epochs: %lu\n", ran);
+  printf("converged: %d\n", converged);
+  printf("train_seconds: %.6f\n", elapsed);
+  printf("epochs_per_second: %.1f\n", elapsed > 0 ? ran / elapsed : 0);
+  return 0;
+}